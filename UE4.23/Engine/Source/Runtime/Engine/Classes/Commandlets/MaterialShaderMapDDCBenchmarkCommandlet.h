@@ -0,0 +1,38 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "Commandlets/Commandlet.h"
+#include "MaterialShaderMapDDCBenchmarkCommandlet.generated.h"
+
+/**
+ * Measures the DDC payload size of the project's material shader maps against their load latency, for the payload codec
+ * r.MaterialShaderMap.DDCCompression selects (MaterialShaderDDCCompression.h).
+ *
+ * The shader maps of the materials under -Path are written with FMaterialShaderMap::SaveToDerivedDataCache, then read back with
+ * FMaterialShaderMap::LoadFromDerivedDataCache, the paths the editor and the cooker take. The modeled load latency adds the time to
+ * transfer the payloads at -MBps, which models a shared DDC volume, to the measured load time. The shader resources stay in memory,
+ * so with r.MaterialShaderMap.SharedBytecode the loads do not fetch the bytecode again.
+ *
+ * The codec cvar is read only, each run appends one row to the CSV. Compare the codecs with one run each:
+ *	UE4Editor-Cmd <Project> -run=MaterialShaderMapDDCBenchmark -ini:Engine:[ConsoleVariables]:r.MaterialShaderMap.DDCCompression=0
+ *	UE4Editor-Cmd <Project> -run=MaterialShaderMapDDCBenchmark -ini:Engine:[ConsoleVariables]:r.MaterialShaderMap.DDCCompression=1
+ *
+ * Usage: UE4Editor-Cmd <Project> -run=MaterialShaderMapDDCBenchmark [-Path=/Game] [-MBps=100] [-Iterations=3] [-CSV=<Path>]
+ *
+ *	-Path		Content path of the materials. Defaults to /Game.
+ *	-MBps		Bandwidth of the DDC the latency is modeled for, in MB per second. Defaults to 100.
+ *	-Iterations	Load passes over the shader maps, the fastest is kept. Defaults to 3.
+ *	-CSV		Appended to. Defaults to <ProjectSaved>/Profiling/MaterialShaderMapDDCBenchmark.csv.
+ */
+UCLASS()
+class UMaterialShaderMapDDCBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
@@ -0,0 +1,34 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "Commandlets/Commandlet.h"
+#include "ShadingModelCompileStatsCommandlet.generated.h"
+
+/**
+ * Cooks the shaders of every material of the project and writes what they cost per shading model (FMaterialShaderCompileStats):
+ * compile jobs, compile seconds, bytecode bytes and instructions.
+ *
+ * Materials and material instances are cached for the target platforms the way the cook does, through
+ * BeginCacheForCookedPlatformData, in batches that are freed once their shaders are compiled. Only shaders actually compiled are
+ * counted; run with a cold or disabled DDC (e.g. -ddc=NoShared with an empty local cache) to measure the whole project.
+ * The DDC and load time bytes r.MaterialShaderMap.SharedBytecode saved over the run are logged as well.
+ *
+ * Usage: UE4Editor-Cmd <Project> -run=ShadingModelCompileStats -TargetPlatform=<Platform>[+<Platform>] [-Path=/Game] [-Batch=N] [-CSV=<Path>]
+ *
+ *	-TargetPlatform	Platforms to cook the shaders for, as for the cook commandlet.
+ *	-Path			Only cook the materials under this content path. Defaults to /Game.
+ *	-Batch			Materials cached at once. Defaults to 256.
+ *	-CSV			Defaults to <ProjectSaved>/Profiling/ShadingModelCompileStats.csv.
+ */
+UCLASS()
+class UShadingModelCompileStatsCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
@@ -0,0 +1,39 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "Commandlets/Commandlet.h"
+#include "ToonShaderCompileStatsCommandlet.generated.h"
+
+/**
+ * Compiles the toon shader permutations offline and records their cost, so that regressions in the toon BxDFs show up in CI without a GPU.
+ *
+ * For every combination of the MATERIAL_SHADINGMODEL_TOON* defines FHLSLMaterialTranslator::GetMaterialEnvironment can emit, a transient
+ * material using those shading models is compiled for the given shader format, and the BasePassPixelShader.usf shaders of its shader map
+ * are recorded. The deferred light shaders (DeferredLightPixelShaders.usf) come from the global shader map of the same format.
+ *
+ * Usage: UE4Editor-Cmd <Project> -run=ToonShaderCompileStats [-Format=SF_VULKAN_SM5] [-VertexFactory=FLocalVertexFactory] [-CSV=<Path>] [-PruningCSV=<Path>]
+ *
+ *	-Format			Shader format to compile for. The format decides the compiler backend. Defaults to SF_VULKAN_SM5, which compiles on Linux.
+ *	-VertexFactory	Only record material shaders for this vertex factory. Defaults to FLocalVertexFactory.
+ *	-CSV			Writes one row per shader. Defaults to <ProjectSaved>/Profiling/ToonShaderCompileStats.csv.
+ *	-PruningCSV		Writes how many shaders of each permutation every UToonShaderPermutationSettings rule removes, over all vertex factories.
+ *					Defaults to <ProjectSaved>/Profiling/ToonShaderPruning.csv.
+ *
+ * With r.Toon.MaterialParameterTable set (WITH_TOON_MATERIAL_PARAMETER_TABLE builds), a Toon material whose toon inputs are scalar parameters is compiled as well, and the commandlet
+ * fails unless its shader map evaluates the toon material slot.
+ *
+ * Instruction counts are the ones the shader format reports. Shader compiler output carries no register counts in this engine
+ * version, so the VGPR/SGPR columns are written empty to keep the CSV layout stable for when a backend provides them.
+ */
+UCLASS()
+class UToonShaderCompileStatsCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
@@ -0,0 +1,36 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "Commandlets/Commandlet.h"
+#include "ToonShadingBenchmarkCommandlet.generated.h"
+
+/**
+ * Runs the toon shading CPU reference code (ToonShadingReference.h) to validate it and measure its cost without a GPU.
+ *
+ * Usage: UE4Editor-Cmd <Project> -run=ToonShadingBenchmark [-Codecs] [-Ramp] [-Tiles [-GBuffer=<Path>]] [-PropertyMasks] [-Hair] [-Bake [-Texels=N] [-Lights=N]] [-Bits=8|10] [-CSV=<Path>]
+ *
+ *	-Codecs		Exhaustive round trip of the toon GBuffer packing codecs over every quantized input.
+ *	-Ramp		Accuracy of the baked toon ramp LUT (TOON_RAMP_LUT) against ToonStep.
+ *	-Tiles		CPU emulation of the toon tile classification pass (ToonTileClassification.usf), and a wave model of the
+ *				IntegrateBxDF divergence with and without TOON_SCALARIZE_BXDF_DISPATCH.
+ *	-GBuffer	8 bit image dump of GBufferB for -Tiles. Without it a synthetic frame is classified.
+ *	-PropertyMasks	Shading model part of the material property activity queries, every property against every shading model field.
+ *	-Hair		ToonHairBxDF batch evaluator against its scalar reference, and the cost of its sub-terms.
+ *	-Bake		Multithreaded toon light bake (ToonLightBake.h) against a texel by texel loop, and its scaling over one thread.
+ *	-Texels		Texels baked by -Bake. Defaults to 65536.
+ *	-Lights		Lights baked by -Bake. Defaults to 64.
+ *	-Bits		Quantization of the inputs and of the GBuffer channel the codec is stored in. Defaults to 8.
+ *	-CSV		Also writes the results to the given file.
+ */
+UCLASS()
+class UToonShadingBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+};
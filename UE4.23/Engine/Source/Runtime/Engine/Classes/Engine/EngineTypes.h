@@ -485,6 +485,10 @@ enum EMaterialShadingModel
 	MSM_MAX
 };
 
+/**
+ * The GBuffer stores the shading model ID in 5 bits (SHADINGMODELID_MASK in ShadingCommon.ush), but FMaterialShadingModelField and the
+ * shading model masks of the renderer (FMaterialRelevance, FPrimitiveViewRelevance, FViewInfo) are still 16 bits wide.
+ */
 static_assert(MSM_NUM <= 16, "Do not exceed 16 shading models without expanding FMaterialShadingModelField to support uint32 instead of uint16!");
 
 /** Wrapper for a bitfield of shading models. A material contains one of these to describe what possible shading models can be used by that material. */
@@ -0,0 +1,81 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectMacros.h"
+#include "Engine/DeveloperSettings.h"
+#include "Engine/EngineTypes.h"
+#include "RHIDefinitions.h"
+#include "ToonShaderPermutationSettings.generated.h"
+
+class FMaterial;
+class FShaderType;
+class FVertexFactoryType;
+
+/**
+ * Removes mesh material and material shaders from the shader maps of the materials whose shading models are all listed,
+ * through FMaterial::ShouldCache. The renderer asserts when it asks for a shader that was removed, so a rule must only
+ * list shaders the project never renders with those materials (e.g. lightmap policies when toon meshes are never lightmapped).
+ */
+USTRUCT()
+struct FToonShaderPermutationRule
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Shown in the pruning report. */
+	UPROPERTY(config, EditAnywhere, Category = Rule)
+	FString Name;
+
+	/** The rule applies to materials whose shading models are all in this list. */
+	UPROPERTY(config, EditAnywhere, Category = Rule)
+	TArray<TEnumAsByte<EMaterialShadingModel>> ShadingModels;
+
+	/** Wildcards matched against the shader type names, e.g. TBasePassPS*LightMapPolicy*. */
+	UPROPERTY(config, EditAnywhere, Category = Rule)
+	TArray<FString> ShaderTypes;
+
+	/** Wildcards matched against the vertex factory type names. Empty matches every vertex factory, and the shaders without one. */
+	UPROPERTY(config, EditAnywhere, Category = Rule)
+	TArray<FString> VertexFactoryTypes;
+
+	/** Leaves the translucent and modulated materials alone. */
+	UPROPERTY(config, EditAnywhere, Category = Rule)
+	bool bOpaqueAndMaskedOnly = true;
+};
+
+/**
+ * Per project shader permutation pruning of the toon materials, stored in DefaultEngine.ini:
+ *
+ *	[/Script/Engine.ToonShaderPermutationSettings]
+ *	+Rules=(Name="NoLightmaps",ShadingModels=(MSM_Toon,MSM_ToonSkin,MSM_ToonHair),ShaderTypes=("*LightMapPolicy*","*LightmapPolicy*"))
+ *
+ * Changing the rules changes the shader map DDC keys of every material (see AppendToonShaderPruningKeyString) and needs an
+ * editor restart. The ToonShaderCompileStats commandlet reports how many shaders each rule removes.
+ */
+UCLASS(config = Engine, defaultconfig, meta = (DisplayName = "Toon Shader Permutations"))
+class ENGINE_API UToonShaderPermutationSettings : public UDeveloperSettings
+{
+	GENERATED_UCLASS_BODY()
+
+	/** Evaluated in order, the first matching rule removes the shader. */
+	UPROPERTY(config, EditAnywhere, Category = Pruning)
+	TArray<FToonShaderPermutationRule> Rules;
+};
+
+/**
+ * Index in UToonShaderPermutationSettings::Rules of the rule removing a shader from the shader map of Material, INDEX_NONE if it is kept.
+ * @param VertexFactoryType	nullptr for material shaders
+ */
+ENGINE_API int32 FindToonShaderPruningRule(const FMaterial& Material, const FShaderType* ShaderType, const FVertexFactoryType* VertexFactoryType);
+
+/** Adds the pruning rules to a shader map DDC key, nothing when there are none. */
+ENGINE_API void AppendToonShaderPruningKeyString(FString& KeyString);
+
+/**
+ * Number of shaders of Material each rule removes on Platform, among the permutations its shader and vertex factory types would
+ * otherwise compile. Shader pipelines are not counted separately from their stages.
+ * @param OutNumPrunedPerRule	One entry per rule
+ * @return number of shaders kept
+ */
+ENGINE_API int32 GetToonShaderPruningReport(const FMaterial& Material, EShaderPlatform Platform, TArray<int32>& OutNumPrunedPerRule);
@@ -1501,6 +1501,14 @@ private:
 	 */
 	void CacheResourceShadersForRendering(bool bRegenerateId);
 
+#if WITH_EDITOR
+	/**
+	 * Requests from the DDC the shader maps CacheResourceShadersForRendering is going to load, see FMaterialShaderMapPrefetcher.
+	 * Also works before the material resources are allocated.
+	 */
+	void PrefetchResourceShadersForRendering();
+#endif
+
 	/**
 	 * Cache resource shaders for cooking on the given shader platform.
 	 * If a matching shader map is not found in memory or the DDC, a new one will be compiled.
@@ -0,0 +1,188 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialShaderMapDDCBenchmarkCommandlet.cpp: Size and load latency of the material shader map DDC payloads.
+=============================================================================*/
+
+#include "Commandlets/MaterialShaderMapDDCBenchmarkCommandlet.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Modules/ModuleManager.h"
+#include "AssetRegistryModule.h"
+#include "Materials/MaterialInterface.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialInstance.h"
+#include "Materials/MaterialShaderDDCCompression.h"
+#include "MaterialShared.h"
+#include "RHI.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMaterialShaderMapDDCBenchmark, Log, All);
+
+#if WITH_EDITOR
+
+namespace MaterialShaderMapDDCBenchmark
+{
+	struct FShaderMapEntry
+	{
+		const FMaterialResource* Resource;
+		TRefCountPtr<FMaterialShaderMap> ShaderMap;
+	};
+
+	/** Loads every shader map back through FMaterialShaderMap::LoadFromDerivedDataCache. @return false if one was missing from the DDC */
+	static bool LoadShaderMaps(const TArray<FShaderMapEntry>& Entries, double& OutSeconds)
+	{
+		bool bAllFound = true;
+		OutSeconds = 0.0;
+		for (const FShaderMapEntry& Entry : Entries)
+		{
+			const EShaderPlatform Platform = Entry.ShaderMap->GetShaderPlatform();
+
+			TRefCountPtr<FMaterialShaderMap> LoadedShaderMap;
+			const double StartTime = FPlatformTime::Seconds();
+			FMaterialShaderMap::LoadFromDerivedDataCache(Entry.Resource, Entry.ShaderMap->GetShaderMapId(), Platform, LoadedShaderMap);
+			OutSeconds += FPlatformTime::Seconds() - StartTime;
+
+			bAllFound &= LoadedShaderMap.IsValid();
+
+			// The loaded copy registered itself under the same id and unregisters the id when released, give it back to the resource's shader map
+			LoadedShaderMap = nullptr;
+			Entry.ShaderMap->Register(Platform);
+		}
+		return bAllFound;
+	}
+}
+
+#endif // WITH_EDITOR
+
+UMaterialShaderMapDDCBenchmarkCommandlet::UMaterialShaderMapDDCBenchmarkCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UMaterialShaderMapDDCBenchmarkCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	using namespace MaterialShaderMapDDCBenchmark;
+
+	FString ContentPath = TEXT("/Game");
+	FParse::Value(*Params, TEXT("Path="), ContentPath);
+
+	float MBps = 100.f;
+	FParse::Value(*Params, TEXT("MBps="), MBps);
+	MBps = FMath::Max(MBps, 0.001f);
+
+	int32 NumIterations = 3;
+	FParse::Value(*Params, TEXT("Iterations="), NumIterations);
+	NumIterations = FMath::Max(NumIterations, 1);
+
+	FString CSVFilename = FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("MaterialShaderMapDDCBenchmark.csv");
+	FParse::Value(*Params, TEXT("CSV="), CSVFilename);
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.PackagePaths.Add(FName(*ContentPath));
+	Filter.bRecursivePaths = true;
+	Filter.ClassNames.Add(UMaterial::StaticClass()->GetFName());
+	Filter.ClassNames.Add(UMaterialInstance::StaticClass()->GetFName());
+	Filter.bRecursiveClasses = true;
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+
+	// One entry per distinct shader map. Instances without static parameters share the shader map of their parent.
+	TSet<const FMaterialShaderMap*> VisitedShaderMaps;
+	TArray<FShaderMapEntry> Entries;
+	for (const FAssetData& Asset : Assets)
+	{
+		UMaterialInterface* Material = Cast<UMaterialInterface>(Asset.GetAsset());
+		FMaterialResource* Resource = Material ? Material->GetMaterialResource(GMaxRHIFeatureLevel) : nullptr;
+		if (!Resource)
+		{
+			continue;
+		}
+
+		Resource->FinishCompilation();
+		FMaterialShaderMap* ShaderMap = Resource->GetGameThreadShaderMap();
+		if (!ShaderMap || VisitedShaderMaps.Contains(ShaderMap))
+		{
+			continue;
+		}
+		VisitedShaderMaps.Add(ShaderMap);
+		Entries.Add({ Resource, ShaderMap });
+	}
+
+	if (Entries.Num() == 0)
+	{
+		UE_LOG(LogMaterialShaderMapDDCBenchmark, Error, TEXT("No material shader map under %s"), *ContentPath);
+		return 1;
+	}
+
+	const FName Format = MaterialShaderDDCCompression::GetFormat();
+	const FString CodecName = Format == NAME_None ? TEXT("None") : Format.ToString();
+	UE_LOG(LogMaterialShaderMapDDCBenchmark, Display, TEXT("%d shader maps from %d materials, payload codec %s"), Entries.Num(), Assets.Num(), *CodecName);
+
+	// Payloads written by this pass only, shared shader resources already stored this session are not written again
+	const MaterialShaderDDCCompression::FPayloadStats StatsBeforeSave = MaterialShaderDDCCompression::GetPayloadStats();
+	const double SaveStartTime = FPlatformTime::Seconds();
+	for (const FShaderMapEntry& Entry : Entries)
+	{
+		Entry.ShaderMap->SaveToDerivedDataCache();
+	}
+	const double SaveSeconds = FPlatformTime::Seconds() - SaveStartTime;
+	const MaterialShaderDDCCompression::FPayloadStats StatsAfterSave = MaterialShaderDDCCompression::GetPayloadStats();
+
+	const int64 RawBytes = StatsAfterSave.RawBytes - StatsBeforeSave.RawBytes;
+	const int64 PayloadBytes = StatsAfterSave.PayloadBytes - StatsBeforeSave.PayloadBytes;
+
+	double LoadSeconds = TNumericLimits<double>::Max();
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		double IterationSeconds = 0.0;
+		if (!LoadShaderMaps(Entries, IterationSeconds))
+		{
+			UE_LOG(LogMaterialShaderMapDDCBenchmark, Error, TEXT("Some shader maps saved to the DDC could not be loaded back"));
+			return 1;
+		}
+		LoadSeconds = FMath::Min(LoadSeconds, IterationSeconds);
+	}
+
+	const double BytesPerSecond = MBps * 1024.0 * 1024.0;
+	const double Ratio = RawBytes > 0 ? (double)PayloadBytes / RawBytes : 1.0;
+	const double TransferSeconds = PayloadBytes / BytesPerSecond;
+	const double ModeledLoadSeconds = TransferSeconds + LoadSeconds;
+
+	UE_LOG(LogMaterialShaderMapDDCBenchmark, Display, TEXT("%-6s %10.2f MB (%5.1f%% of %.2f MB) save %7.3f s, load %7.3f s, transfer at %.0f MB/s %7.3f s, modeled load %7.3f s (%.3f ms per shader map)"),
+		*CodecName, PayloadBytes / (1024.0 * 1024.0), Ratio * 100.0, RawBytes / (1024.0 * 1024.0), SaveSeconds, LoadSeconds, MBps, TransferSeconds, ModeledLoadSeconds,
+		ModeledLoadSeconds * 1000.0 / Entries.Num());
+
+	// One row per run, the codec is a read only cvar
+	FString CSV;
+	if (!IFileManager::Get().FileExists(*CSVFilename))
+	{
+		CSV = TEXT("Codec,ShaderMaps,RawBytes,PayloadBytes,Ratio,SaveSeconds,LoadSeconds,TransferSeconds,ModeledLoadSeconds,ModeledLoadMillisecondsPerShaderMap") LINE_TERMINATOR;
+	}
+	CSV += FString::Printf(TEXT("%s,%d,%lld,%lld,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f") LINE_TERMINATOR,
+		*CodecName, Entries.Num(), RawBytes, PayloadBytes, Ratio, SaveSeconds, LoadSeconds, TransferSeconds, ModeledLoadSeconds,
+		ModeledLoadSeconds * 1000.0 / Entries.Num());
+
+	if (!FFileHelper::SaveStringToFile(CSV, *CSVFilename, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append))
+	{
+		UE_LOG(LogMaterialShaderMapDDCBenchmark, Error, TEXT("Failed to write %s"), *CSVFilename);
+		return 1;
+	}
+	UE_LOG(LogMaterialShaderMapDDCBenchmark, Display, TEXT("Wrote %s"), *CSVFilename);
+	return 0;
+#else
+	UE_LOG(LogMaterialShaderMapDDCBenchmark, Error, TEXT("MaterialShaderMapDDCBenchmark needs an editor build."));
+	return 1;
+#endif // WITH_EDITOR
+}
@@ -0,0 +1,121 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ShadingModelCompileStatsCommandlet.cpp: Per shading model shader compile cost of the project materials.
+=============================================================================*/
+
+#include "Commandlets/ShadingModelCompileStatsCommandlet.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Modules/ModuleManager.h"
+#include "AssetRegistryModule.h"
+#include "Interfaces/ITargetPlatform.h"
+#include "Interfaces/ITargetPlatformManagerModule.h"
+#include "Materials/MaterialInterface.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialInstance.h"
+#include "ShaderCompiler.h"
+#include "MaterialShaderCompileStats.h"
+#include "Materials/MaterialShaderBytecodeStore.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogShadingModelCompileStats, Log, All);
+
+UShadingModelCompileStatsCommandlet::UShadingModelCompileStatsCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UShadingModelCompileStatsCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	FString ContentPath = TEXT("/Game");
+	FParse::Value(*Params, TEXT("Path="), ContentPath);
+
+	int32 BatchSize = 256;
+	FParse::Value(*Params, TEXT("Batch="), BatchSize);
+	BatchSize = FMath::Max(BatchSize, 1);
+
+	FString CSVFilename = FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("ShadingModelCompileStats.csv");
+	FParse::Value(*Params, TEXT("CSV="), CSVFilename);
+
+	// Reads -TargetPlatform= from the command line
+	const TArray<ITargetPlatform*>& TargetPlatforms = GetTargetPlatformManagerRef().GetActiveTargetPlatforms();
+	if (TargetPlatforms.Num() == 0)
+	{
+		UE_LOG(LogShadingModelCompileStats, Error, TEXT("No target platform, pass -TargetPlatform=<Platform>"));
+		return 1;
+	}
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.PackagePaths.Add(FName(*ContentPath));
+	Filter.bRecursivePaths = true;
+	Filter.ClassNames.Add(UMaterial::StaticClass()->GetFName());
+	Filter.ClassNames.Add(UMaterialInstance::StaticClass()->GetFName());
+	Filter.bRecursiveClasses = true;
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+	UE_LOG(LogShadingModelCompileStats, Display, TEXT("Caching the shaders of %d materials under %s..."), Assets.Num(), *ContentPath);
+
+	FMaterialShaderCompileStats::Get().Reset();
+
+	for (int32 BatchStart = 0; BatchStart < Assets.Num(); BatchStart += BatchSize)
+	{
+		const int32 BatchEnd = FMath::Min(BatchStart + BatchSize, Assets.Num());
+
+		TArray<UMaterialInterface*> Materials;
+		for (int32 AssetIndex = BatchStart; AssetIndex < BatchEnd; ++AssetIndex)
+		{
+			if (UMaterialInterface* Material = Cast<UMaterialInterface>(Assets[AssetIndex].GetAsset()))
+			{
+				Materials.Add(Material);
+				for (const ITargetPlatform* TargetPlatform : TargetPlatforms)
+				{
+					Material->BeginCacheForCookedPlatformData(TargetPlatform);
+				}
+			}
+		}
+
+		GShaderCompilingManager->FinishAllCompilation();
+
+		for (UMaterialInterface* Material : Materials)
+		{
+			for (const ITargetPlatform* TargetPlatform : TargetPlatforms)
+			{
+				if (!Material->IsCachedCookedPlatformDataLoaded(TargetPlatform))
+				{
+					UE_LOG(LogShadingModelCompileStats, Warning, TEXT("%s did not finish caching for %s"), *Material->GetPathName(), *TargetPlatform->PlatformName());
+				}
+			}
+			Material->ClearAllCachedCookedPlatformData();
+		}
+
+		UE_LOG(LogShadingModelCompileStats, Display, TEXT("%d/%d materials"), BatchEnd, Assets.Num());
+		CollectGarbage(RF_NoFlags);
+	}
+
+	MaterialShaderBytecodeStore::LogStats();
+
+	const FString CSV = FMaterialShaderCompileStats::Get().ToCSV();
+	UE_LOG(LogShadingModelCompileStats, Display, TEXT("%s"), *CSV);
+
+	if (!FFileHelper::SaveStringToFile(CSV, *CSVFilename))
+	{
+		UE_LOG(LogShadingModelCompileStats, Error, TEXT("Failed to write %s"), *CSVFilename);
+		return 1;
+	}
+	UE_LOG(LogShadingModelCompileStats, Display, TEXT("Wrote %s"), *CSVFilename);
+	return 0;
+#else
+	UE_LOG(LogShadingModelCompileStats, Error, TEXT("ShadingModelCompileStats needs an editor build."));
+	return 1;
+#endif // WITH_EDITOR
+}
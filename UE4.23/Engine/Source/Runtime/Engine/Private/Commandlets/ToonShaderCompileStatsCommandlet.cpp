@@ -0,0 +1,356 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonShaderCompileStatsCommandlet.cpp: Offline compile and cost report of the toon shader permutations.
+=============================================================================*/
+
+#include "Commandlets/ToonShaderCompileStatsCommandlet.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+#include "UObject/UnrealType.h"
+#include "Interfaces/ITargetPlatform.h"
+#include "Interfaces/ITargetPlatformManagerModule.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialExpressionShadingModel.h"
+#include "Materials/MaterialExpressionScalarParameter.h"
+#include "Materials/ToonMaterialUniformExpressions.h"
+#include "MaterialShared.h"
+#include "MaterialShader.h"
+#include "GlobalShader.h"
+#include "ShaderCompiler.h"
+#include "RenderingThread.h"
+#include "Engine/ToonShaderPermutationSettings.h"
+#include "ToonMaterialParameterTable.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogToonShaderCompileStats, Log, All);
+
+#if WITH_EDITOR
+
+namespace ToonShaderCompileStats
+{
+	/** Shading models with a MATERIAL_SHADINGMODEL_TOON* define in FHLSLMaterialTranslator::GetMaterialEnvironment. */
+	static const EMaterialShadingModel ToonShadingModels[] = { MSM_Toon, MSM_ToonSkin, MSM_ToonHair, MSM_ToonAniso };
+
+	static const TCHAR* BasePassShaderFilename = TEXT("/Engine/Private/BasePassPixelShader.usf");
+	static const TCHAR* DeferredLightShaderFilename = TEXT("/Engine/Private/DeferredLightPixelShaders.usf");
+
+	struct FShaderStatsRow
+	{
+		FString Permutation;
+		FString ShaderFile;
+		FString ShaderType;
+		FString VertexFactory;
+		int32 PermutationId = 0;
+		uint32 NumInstructions = 0;
+		/** Wall time of the whole permutation's shader map, < 0 when it was not compiled here. */
+		double CompileSeconds = -1.0;
+	};
+
+	static FString GetPermutationName(uint32 ShadingModelMask)
+	{
+		FString Name;
+		for (int32 Index = 0; Index < ARRAY_COUNT(ToonShadingModels); ++Index)
+		{
+			if (ShadingModelMask & (1u << Index))
+			{
+				if (!Name.IsEmpty())
+				{
+					Name += TEXT("+");
+				}
+				Name += StaticEnum<EMaterialShadingModel>()->GetNameStringByValue(ToonShadingModels[Index]);
+			}
+		}
+		return Name;
+	}
+
+	/**
+	 * Frees a resource from AllocateResource() along with its transient material. CacheShaders enqueued render commands that still
+	 * reference the resource, so they are flushed first like UMaterial::ClearCachedCookedPlatformData does.
+	 */
+	static void DestroyMaterialResource(UMaterial* Material, FMaterialResource* Resource)
+	{
+		FlushRenderingCommands();
+		delete Resource;
+		Material->MarkPendingKill();
+	}
+
+	/** Transient material whose shading model field matches ShadingModelMask, the same way a user material would get it. */
+	static UMaterial* CreatePermutationMaterial(uint32 ShadingModelMask)
+	{
+		UMaterial* Material = NewObject<UMaterial>(GetTransientPackage(), NAME_None, RF_Transient);
+
+		if (FMath::CountBits(ShadingModelMask) == 1)
+		{
+			Material->SetShadingModel(ToonShadingModels[FMath::CountTrailingZeros(ShadingModelMask)]);
+		}
+		else
+		{
+			// Several shading models come from ShadingModel expressions in the graph, see UMaterial::RebuildShadingModelField()
+			for (int32 Index = 0; Index < ARRAY_COUNT(ToonShadingModels); ++Index)
+			{
+				if (ShadingModelMask & (1u << Index))
+				{
+					UMaterialExpressionShadingModel* Expression = NewObject<UMaterialExpressionShadingModel>(Material);
+					Expression->ShadingModel = ToonShadingModels[Index];
+					Material->Expressions.Add(Expression);
+				}
+			}
+
+			UByteProperty* ShadingModelProperty = FindFieldChecked<UByteProperty>(UMaterial::StaticClass(), TEXT("ShadingModel"));
+			ShadingModelProperty->SetPropertyValue_InContainer(Material, (uint8)MSM_FromMaterialExpression);
+			Material->RebuildShadingModelField();
+		}
+
+		return Material;
+	}
+
+	/** Transient Toon material whose toon inputs are all scalar parameters, the materials the toon material parameter table is for. */
+	static UMaterial* CreateParameterTableMaterial()
+	{
+		UMaterial* Material = NewObject<UMaterial>(GetTransientPackage(), NAME_None, RF_Transient);
+		Material->SetShadingModel(MSM_Toon);
+
+		// CustomData0 and CustomData1 are the ClearCoat and ClearCoatRoughness inputs
+		FScalarMaterialInput* ToonInputs[] = { &Material->ClearCoat, &Material->ClearCoatRoughness, &Material->SpecularOffset, &Material->SpecularRange };
+		for (int32 Index = 0; Index < ARRAY_COUNT(ToonInputs); ++Index)
+		{
+			UMaterialExpressionScalarParameter* Parameter = NewObject<UMaterialExpressionScalarParameter>(Material);
+			Parameter->ParameterName = *FString::Printf(TEXT("ToonInput%d"), Index);
+			Parameter->DefaultValue = 0.5f;
+			Material->Expressions.Add(Parameter);
+			ToonInputs[Index]->Expression = Parameter;
+		}
+
+		return Material;
+	}
+
+	/**
+	 * Compiles CreateParameterTableMaterial() and checks its shader map evaluates the toon material slot per render proxy.
+	 * @return false when the material failed to compile or does not use the table
+	 */
+	static bool VerifyParameterTableMaterial(EShaderPlatform ShaderPlatform, ERHIFeatureLevel::Type FeatureLevel, const ITargetPlatform* TargetPlatform)
+	{
+		UMaterial* Material = CreateParameterTableMaterial();
+		FMaterialResource* Resource = Material->AllocateResource();
+		Resource->SetMaterial(Material, EMaterialQualityLevel::High, false, FeatureLevel);
+		Resource->CacheShaders(ShaderPlatform, TargetPlatform);
+		Resource->FinishCompilation();
+
+		bool bUsesSlot = false;
+		const FMaterialShaderMap* ShaderMap = Resource->GetGameThreadShaderMap();
+		if (ShaderMap && Resource->GetCompileErrors().Num() == 0)
+		{
+			for (const TRefCountPtr<FMaterialUniformExpression>& Expression : ShaderMap->GetUniformExpressionSet().UniformVectorExpressions)
+			{
+				bUsesSlot |= Expression->GetType() == &FMaterialUniformExpressionToonMaterialSlot::StaticType;
+			}
+			if (!bUsesSlot)
+			{
+				UE_LOG(LogToonShaderCompileStats, Error, TEXT("The parameterized Toon material does not evaluate its toon material parameter table slot"));
+			}
+		}
+		else
+		{
+			UE_LOG(LogToonShaderCompileStats, Error, TEXT("The parameterized Toon material failed to compile:"));
+			for (const FString& CompileError : Resource->GetCompileErrors())
+			{
+				UE_LOG(LogToonShaderCompileStats, Error, TEXT("	%s"), *CompileError);
+			}
+		}
+
+		DestroyMaterialResource(Material, Resource);
+		return bUsesSlot;
+	}
+
+	static void AddShaderRows(const TMap<FShaderId, FShader*>& Shaders, const TCHAR* ShaderFilename, const FName VertexFactoryName, const FString& Permutation, double CompileSeconds, TArray<FShaderStatsRow>& OutRows)
+	{
+		for (const TPair<FShaderId, FShader*>& Pair : Shaders)
+		{
+			const FShaderId& Id = Pair.Key;
+			const FShader* Shader = Pair.Value;
+			if (!Shader || FCString::Strcmp(Id.ShaderType->GetShaderFilename(), ShaderFilename) != 0)
+			{
+				continue;
+			}
+			if (VertexFactoryName != NAME_None && (!Id.VFType || Id.VFType->GetFName() != VertexFactoryName))
+			{
+				continue;
+			}
+
+			FShaderStatsRow& Row = OutRows.AddDefaulted_GetRef();
+			Row.Permutation = Permutation;
+			Row.ShaderFile = FPaths::GetCleanFilename(ShaderFilename);
+			Row.ShaderType = Id.ShaderType->GetName();
+			Row.VertexFactory = Id.VFType ? Id.VFType->GetName() : TEXT("");
+			Row.PermutationId = Id.PermutationId;
+			Row.NumInstructions = Shader->GetNumInstructions();
+			Row.CompileSeconds = CompileSeconds;
+		}
+	}
+
+	static const ITargetPlatform* FindTargetPlatformForFormat(const FName ShaderFormat)
+	{
+		for (const ITargetPlatform* TargetPlatform : GetTargetPlatformManagerRef().GetTargetPlatforms())
+		{
+			TArray<FName> ShaderFormats;
+			TargetPlatform->GetAllTargetedShaderFormats(ShaderFormats);
+			if (ShaderFormats.Contains(ShaderFormat))
+			{
+				return TargetPlatform;
+			}
+		}
+		return nullptr;
+	}
+}
+
+#endif // WITH_EDITOR
+
+UToonShaderCompileStatsCommandlet::UToonShaderCompileStatsCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UToonShaderCompileStatsCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	using namespace ToonShaderCompileStats;
+
+	FString FormatName = TEXT("SF_VULKAN_SM5");
+	FParse::Value(*Params, TEXT("Format="), FormatName);
+	const FName ShaderFormat(*FormatName);
+
+	FString VertexFactoryName = TEXT("FLocalVertexFactory");
+	FParse::Value(*Params, TEXT("VertexFactory="), VertexFactoryName);
+
+	FString CSVFilename = FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("ToonShaderCompileStats.csv");
+	FParse::Value(*Params, TEXT("CSV="), CSVFilename);
+
+	FString PruningCSVFilename = FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("ToonShaderPruning.csv");
+	FParse::Value(*Params, TEXT("PruningCSV="), PruningCSVFilename);
+
+	const ITargetPlatform* TargetPlatform = FindTargetPlatformForFormat(ShaderFormat);
+	if (!TargetPlatform)
+	{
+		UE_LOG(LogToonShaderCompileStats, Error, TEXT("No target platform compiles %s"), *FormatName);
+		return 1;
+	}
+
+	const EShaderPlatform ShaderPlatform = ShaderFormatToLegacyShaderPlatform(ShaderFormat);
+	const ERHIFeatureLevel::Type FeatureLevel = GetMaxSupportedFeatureLevel(ShaderPlatform);
+
+	TArray<FShaderStatsRow> Rows;
+
+	const TArray<FToonShaderPermutationRule>& PruningRules = GetDefault<UToonShaderPermutationSettings>()->Rules;
+	FString PruningCSV = TEXT("Format,Permutation,Rule,Shaders") LINE_TERMINATOR;
+
+	// Every non empty combination of the toon shading models
+	const uint32 NumPermutations = 1u << ARRAY_COUNT(ToonShadingModels);
+	for (uint32 ShadingModelMask = 1; ShadingModelMask < NumPermutations; ++ShadingModelMask)
+	{
+		const FString Permutation = GetPermutationName(ShadingModelMask);
+		UE_LOG(LogToonShaderCompileStats, Display, TEXT("Compiling %s for %s..."), *Permutation, *FormatName);
+
+		UMaterial* Material = CreatePermutationMaterial(ShadingModelMask);
+		FMaterialResource* Resource = Material->AllocateResource();
+		Resource->SetMaterial(Material, EMaterialQualityLevel::High, false, FeatureLevel);
+
+		// Shaders removed from this permutation by each UToonShaderPermutationSettings rule, counted over every vertex factory
+		TArray<int32> NumPrunedPerRule;
+		const int32 NumKept = GetToonShaderPruningReport(*Resource, ShaderPlatform, NumPrunedPerRule);
+		PruningCSV += FString::Printf(TEXT("%s,%s,Kept,%d") LINE_TERMINATOR, *FormatName, *Permutation, NumKept);
+		for (int32 RuleIndex = 0; RuleIndex < PruningRules.Num(); ++RuleIndex)
+		{
+			UE_LOG(LogToonShaderCompileStats, Display, TEXT("	Rule %s removes %d shaders, %d kept"), *PruningRules[RuleIndex].Name, NumPrunedPerRule[RuleIndex], NumKept);
+			PruningCSV += FString::Printf(TEXT("%s,%s,%s,%d") LINE_TERMINATOR, *FormatName, *Permutation, *PruningRules[RuleIndex].Name, NumPrunedPerRule[RuleIndex]);
+		}
+
+		// The transient material has a fresh state id, so this is never served from the DDC
+		const double StartTime = FPlatformTime::Seconds();
+		Resource->CacheShaders(ShaderPlatform, TargetPlatform);
+		Resource->FinishCompilation();
+		const double CompileSeconds = FPlatformTime::Seconds() - StartTime;
+
+		const FMaterialShaderMap* ShaderMap = Resource->GetGameThreadShaderMap();
+		if (ShaderMap && Resource->GetCompileErrors().Num() == 0)
+		{
+			TMap<FShaderId, FShader*> Shaders;
+			ShaderMap->GetShaderList(Shaders);
+			AddShaderRows(Shaders, BasePassShaderFilename, FName(*VertexFactoryName), Permutation, CompileSeconds, Rows);
+		}
+		else
+		{
+			UE_LOG(LogToonShaderCompileStats, Error, TEXT("%s failed to compile:"), *Permutation);
+			for (const FString& CompileError : Resource->GetCompileErrors())
+			{
+				UE_LOG(LogToonShaderCompileStats, Error, TEXT("	%s"), *CompileError);
+			}
+		}
+
+		DestroyMaterialResource(Material, Resource);
+	}
+
+	// Parameters reach the table through the uniform expression set only, a translator regression compiles but shades every proxy alike
+	bool bParameterTableVerified = true;
+	if (IsToonMaterialParameterTableEnabled())
+	{
+		UE_LOG(LogToonShaderCompileStats, Display, TEXT("Compiling a parameterized Toon material for the toon material parameter table..."));
+		bParameterTableVerified = VerifyParameterTableMaterial(ShaderPlatform, FeatureLevel, TargetPlatform);
+	}
+
+	// The deferred light shaders are global shaders. They do not depend on the material defines, every toon path is in each of them.
+	CompileGlobalShaderMap(ShaderPlatform, TargetPlatform, false);
+	if (TShaderMap<FGlobalShaderType>* GlobalShaderMap = GetGlobalShaderMap(ShaderPlatform))
+	{
+		TMap<FShaderId, FShader*> Shaders;
+		GlobalShaderMap->GetShaderList(Shaders);
+		AddShaderRows(Shaders, DeferredLightShaderFilename, NAME_None, TEXT("Global"), -1.0, Rows);
+	}
+
+	Rows.Sort([](const FShaderStatsRow& A, const FShaderStatsRow& B)
+	{
+		if (A.Permutation != B.Permutation)
+		{
+			return A.Permutation < B.Permutation;
+		}
+		if (A.ShaderType != B.ShaderType)
+		{
+			return A.ShaderType < B.ShaderType;
+		}
+		return A.PermutationId < B.PermutationId;
+	});
+
+	FString CSV = TEXT("Format,Permutation,ShaderFile,ShaderType,VertexFactory,PermutationId,Instructions,VGPRs,SGPRs,PermutationCompileSeconds") LINE_TERMINATOR;
+	for (const FShaderStatsRow& Row : Rows)
+	{
+		UE_LOG(LogToonShaderCompileStats, Display, TEXT("%-40s %-48s %6d %8u"), *Row.Permutation, *Row.ShaderType, Row.PermutationId, Row.NumInstructions);
+		CSV += FString::Printf(TEXT("%s,%s,%s,%s,%s,%d,%u,,,%s") LINE_TERMINATOR,
+			*FormatName, *Row.Permutation, *Row.ShaderFile, *Row.ShaderType, *Row.VertexFactory, Row.PermutationId, Row.NumInstructions,
+			Row.CompileSeconds >= 0.0 ? *FString::Printf(TEXT("%.3f"), Row.CompileSeconds) : TEXT(""));
+	}
+
+	if (!FFileHelper::SaveStringToFile(CSV, *CSVFilename))
+	{
+		UE_LOG(LogToonShaderCompileStats, Error, TEXT("Failed to write %s"), *CSVFilename);
+		return 1;
+	}
+	UE_LOG(LogToonShaderCompileStats, Display, TEXT("Wrote %d shaders to %s"), Rows.Num(), *CSVFilename);
+
+	if (!FFileHelper::SaveStringToFile(PruningCSV, *PruningCSVFilename))
+	{
+		UE_LOG(LogToonShaderCompileStats, Error, TEXT("Failed to write %s"), *PruningCSVFilename);
+		return 1;
+	}
+	UE_LOG(LogToonShaderCompileStats, Display, TEXT("Wrote the shader pruning report to %s"), *PruningCSVFilename);
+	return bParameterTableVerified ? 0 : 1;
+#else
+	UE_LOG(LogToonShaderCompileStats, Error, TEXT("ToonShaderCompileStats needs an editor build."));
+	return 1;
+#endif // WITH_EDITOR
+}
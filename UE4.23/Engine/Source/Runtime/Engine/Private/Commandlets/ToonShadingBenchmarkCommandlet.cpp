@@ -0,0 +1,1036 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonShadingBenchmarkCommandlet.cpp: CPU validation and cost measurement of the toon shading code.
+=============================================================================*/
+
+#include "Commandlets/ToonShadingBenchmarkCommandlet.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Math/RandomStream.h"
+#include "Containers/IndirectArray.h"
+#include "Modules/ModuleManager.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "ToonShadingReference.h"
+#include "ToonRampLUT.h"
+#include "ToonTileClassification.h"
+#include "ToonLightBake.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Materials/MaterialPropertyShadingModels.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogToonShadingBenchmark, Log, All);
+
+namespace ToonShadingBenchmark
+{
+	using namespace ToonShading;
+
+	/** Error statistics and timing of one benchmarked function. */
+	struct FBenchmarkResult
+	{
+		FString Name;
+		int64 NumSamples = 0;
+		/** Samples whose output was NaN or infinite. They are excluded from the error statistics. */
+		int64 NumInvalid = 0;
+		double MaxError = 0.0;
+		double SumError = 0.0;
+		/** Estimated GPU ALU ops, hand counted from the HLSL, not measured. 0 when not applicable. */
+		int32 EstAluOps = 0;
+		double Seconds = 0.0;
+		/** False for the rows that only hold the error of a second output of another row's timed loop. */
+		bool bTimed = true;
+
+		FBenchmarkResult(const TCHAR* InName, int32 InEstAluOps)
+			: Name(InName)
+			, EstAluOps(InEstAluOps)
+		{}
+
+		void AddError(double Error)
+		{
+			if (FMath::IsFinite(Error))
+			{
+				MaxError = FMath::Max(MaxError, Error);
+				SumError += Error;
+			}
+			else
+			{
+				++NumInvalid;
+			}
+		}
+
+		double GetMeanError() const
+		{
+			const int64 NumValid = NumSamples - NumInvalid;
+			return NumValid > 0 ? SumError / (double)NumValid : 0.0;
+		}
+
+		double GetNanosecondsPerSample() const
+		{
+			return NumSamples > 0 ? Seconds * 1e9 / (double)NumSamples : 0.0;
+		}
+
+		/** Empty for the rows without a timing or an estimate, so they do not read as free. */
+		FString GetEstAluOpsString() const
+		{
+			return EstAluOps > 0 ? FString::FromInt(EstAluOps) : FString();
+		}
+
+		FString GetNanosecondsPerSampleString() const
+		{
+			return bTimed ? FString::Printf(TEXT("%.3f"), GetNanosecondsPerSample()) : FString();
+		}
+	};
+
+	class FBenchmarkReport
+	{
+	public:
+		FBenchmarkResult& Add(const TCHAR* Name, int32 EstAluOps)
+		{
+			// Indirect storage keeps previously returned references valid
+			return Results[Results.Add(new FBenchmarkResult(Name, EstAluOps))];
+		}
+
+		/** Row for an output decoded in the timed loop of another row. Only its error is reported, the time is the other row's. */
+		FBenchmarkResult& AddErrorOnly(const TCHAR* Name)
+		{
+			FBenchmarkResult& Result = Add(Name, 0);
+			Result.bTimed = false;
+			return Result;
+		}
+
+		void Print() const
+		{
+			UE_LOG(LogToonShadingBenchmark, Display, TEXT("%-32s %12s %10s %14s %14s %10s %12s"), TEXT("Name"), TEXT("Samples"), TEXT("Invalid"), TEXT("MaxError"), TEXT("MeanError"), TEXT("EstAluOps"), TEXT("ns/sample"));
+			for (const FBenchmarkResult& Result : Results)
+			{
+				UE_LOG(LogToonShadingBenchmark, Display, TEXT("%-32s %12lld %10lld %14.8f %14.8f %10s %12s"),
+					*Result.Name, Result.NumSamples, Result.NumInvalid, Result.MaxError, Result.GetMeanError(), *Result.GetEstAluOpsString(), *Result.GetNanosecondsPerSampleString());
+			}
+		}
+
+		bool SaveCSV(const FString& Filename) const
+		{
+			FString CSV = TEXT("Name,Samples,Invalid,MaxError,MeanError,EstAluOps,NsPerSample") LINE_TERMINATOR;
+			for (const FBenchmarkResult& Result : Results)
+			{
+				CSV += FString::Printf(TEXT("%s,%lld,%lld,%.8f,%.8f,%s,%s") LINE_TERMINATOR,
+					*Result.Name, Result.NumSamples, Result.NumInvalid, Result.MaxError, Result.GetMeanError(), *Result.GetEstAluOpsString(), *Result.GetNanosecondsPerSampleString());
+			}
+			return FFileHelper::SaveStringToFile(CSV, *Filename);
+		}
+
+	private:
+		TIndirectArray<FBenchmarkResult> Results;
+	};
+
+	/**
+	 * Estimated ALU cost of encode + decode for each codec in ToonShadersCommon.ush, counted the same way as
+	 * StandardShadingPerLight in ShadingModels.ush. fmod is counted as 3 ops, floor/frac/saturate as 1, pow(x, 2) as 1
+	 * since the compiler folds it into a multiply, normalize of a float2 as 5.
+	 */
+	static const int32 SpecRangeAluOps			= 7 + 8;
+	static const int32 SSSModeSwitchAluOps		= 7 + 9;
+	/** TOON_INTEGER_GBUFFER_PACKING variants. Float <-> uint conversions are counted as 1 op, like shifts and masks. */
+	static const int32 SpecRangeBitsAluOps		= 9 + 8;
+	static const int32 SSSModeSwitchBitsAluOps	= 8 + 8;
+	/** ToonStep is a smoothstep. ToonRamp with TOON_RAMP_LUT is the UV setup plus one bilinear fetch, which is not counted. */
+	static const int32 ToonStepAluOps			= 8;
+	static const int32 ToonRampLUTAluOps		= 6;
+	static const int32 Color2DAluOps			= 33 + 29;
+	static const int32 UnitVectorAluOps			= 9 + 11;
+	/** TOON_HAIR_ANGLE_TANGENT. atan2 is counted as 17 ops (the polynomial the compilers expand it to), sin and cos as 1 each. */
+	static const int32 UnitVectorAngleAluOps	= 18 + 3;
+
+	/** Angle in degrees between two 2D directions. */
+	static double AngleErrorDegrees(const FVector2D& A, const FVector2D& B)
+	{
+		const double CosAngle = FMath::Clamp((double)FVector2D::DotProduct(A, B), -1.0, 1.0);
+		return FMath::RadiansToDegrees(FMath::Acos(CosAngle));
+	}
+
+	static double MaxAbsError(const FVector& A, const FVector& B)
+	{
+		return (double)(A - B).GetAbsMax();
+	}
+
+	static void RunCodecBenchmarks(int32 Bits, FBenchmarkReport& Report)
+	{
+		const int32 NumSteps = 1 << Bits;
+		const float StepScale = 1.f / (float)(NumSteps - 1);
+
+		// EncodeSpecRange(SpecularOffset, SpecularRange) -> GBuffer.Metallic -> DecodeSpecRange
+		{
+			FBenchmarkResult& OffsetResult = Report.Add(TEXT("SpecRange.Offset"), SpecRangeAluOps);
+			FBenchmarkResult& RangeResult = Report.AddErrorOnly(TEXT("SpecRange.Range"));
+
+			TArray<FVector2D> Decoded;
+			Decoded.SetNumUninitialized(NumSteps * NumSteps);
+
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 YIndex = 0; YIndex < NumSteps; ++YIndex)
+			{
+				for (int32 XIndex = 0; XIndex < NumSteps; ++XIndex)
+				{
+					const float Stored = QuantizeUnorm(EncodeSpecRange(XIndex * StepScale, YIndex * StepScale), Bits);
+					Decoded[YIndex * NumSteps + XIndex] = DecodeSpecRange(Stored);
+				}
+			}
+			OffsetResult.Seconds = FPlatformTime::Seconds() - StartTime;
+			OffsetResult.NumSamples = RangeResult.NumSamples = Decoded.Num();
+
+			for (int32 YIndex = 0; YIndex < NumSteps; ++YIndex)
+			{
+				// The range is deliberately quantized to steps of 1/8 by the encoding
+				const float ExpectedRange = FMath::FloorToFloat(YIndex * StepScale * 0.8f * 8.f) / 8.f;
+				for (int32 XIndex = 0; XIndex < NumSteps; ++XIndex)
+				{
+					const FVector2D& Value = Decoded[YIndex * NumSteps + XIndex];
+					OffsetResult.AddError(FMath::Abs(Value.X - XIndex * StepScale));
+					RangeResult.AddError(FMath::Abs(Value.Y - ExpectedRange));
+				}
+			}
+		}
+
+		// EncodeSSSModeSwitch(Offset, SSSSwitch) -> GBuffer.CustomData.w -> DecodeSSSModeSwitch
+		{
+			FBenchmarkResult& OffsetResult = Report.Add(TEXT("SSSModeSwitch.Offset"), SSSModeSwitchAluOps);
+			FBenchmarkResult& ModeResult = Report.AddErrorOnly(TEXT("SSSModeSwitch.Mode"));
+
+			TArray<FVector2D> Decoded;
+			Decoded.SetNumUninitialized(NumSteps * NumSteps);
+
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 YIndex = 0; YIndex < NumSteps; ++YIndex)
+			{
+				for (int32 XIndex = 0; XIndex < NumSteps; ++XIndex)
+				{
+					const float Stored = QuantizeUnorm(EncodeSSSModeSwitch(XIndex * StepScale, YIndex * StepScale), Bits);
+					Decoded[YIndex * NumSteps + XIndex] = DecodeSSSModeSwitch(Stored);
+				}
+			}
+			OffsetResult.Seconds = FPlatformTime::Seconds() - StartTime;
+			OffsetResult.NumSamples = ModeResult.NumSamples = Decoded.Num();
+
+			for (int32 YIndex = 0; YIndex < NumSteps; ++YIndex)
+			{
+				const float ExpectedMode = FMath::FloorToFloat(FMath::Clamp(YIndex * StepScale, 0.f, 0.99f) * 2.f) / 2.f;
+				for (int32 XIndex = 0; XIndex < NumSteps; ++XIndex)
+				{
+					const FVector2D& Value = Decoded[YIndex * NumSteps + XIndex];
+					OffsetResult.AddError(FMath::Abs(Value.X - XIndex * StepScale));
+					ModeResult.AddError(FMath::Abs(Value.Y - ExpectedMode));
+				}
+			}
+		}
+
+		// Integer bit field packing. GBuffer.Metallic and GBuffer.CustomData live in 8 bit channels regardless of -Bits, so these always
+		// store at 8 bit. Errors are measured against the quantized field values: any non-zero error means the round trip is lossy.
+		{
+			const int32 NumBitsSteps = 256;
+			const float BitsStepScale = 1.f / (float)(NumBitsSteps - 1);
+
+			FBenchmarkResult& SpecOffsetResult = Report.Add(TEXT("SpecRangeBits.Offset"), SpecRangeBitsAluOps);
+			FBenchmarkResult& SpecRangeResult = Report.AddErrorOnly(TEXT("SpecRangeBits.Range"));
+			FBenchmarkResult& SSSOffsetResult = Report.Add(TEXT("SSSModeSwitchBits.Offset"), SSSModeSwitchBitsAluOps);
+			FBenchmarkResult& SSSModeResult = Report.AddErrorOnly(TEXT("SSSModeSwitchBits.Mode"));
+
+			TArray<FVector2D> SpecDecoded;
+			TArray<FVector2D> SSSDecoded;
+			SpecDecoded.SetNumUninitialized(NumBitsSteps * NumBitsSteps);
+			SSSDecoded.SetNumUninitialized(NumBitsSteps * NumBitsSteps);
+
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 YIndex = 0; YIndex < NumBitsSteps; ++YIndex)
+			{
+				for (int32 XIndex = 0; XIndex < NumBitsSteps; ++XIndex)
+				{
+					SpecDecoded[YIndex * NumBitsSteps + XIndex] = DecodeSpecRangeBits(QuantizeUnorm(EncodeSpecRangeBits(XIndex * BitsStepScale, YIndex * BitsStepScale), 8));
+				}
+			}
+			SpecOffsetResult.Seconds = FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			for (int32 YIndex = 0; YIndex < NumBitsSteps; ++YIndex)
+			{
+				for (int32 XIndex = 0; XIndex < NumBitsSteps; ++XIndex)
+				{
+					SSSDecoded[YIndex * NumBitsSteps + XIndex] = DecodeSSSModeSwitchBits(QuantizeUnorm(EncodeSSSModeSwitchBits(XIndex * BitsStepScale, YIndex * BitsStepScale), 8));
+				}
+			}
+			SSSOffsetResult.Seconds = FPlatformTime::Seconds() - StartTime;
+
+			SpecOffsetResult.NumSamples = SpecRangeResult.NumSamples = SpecDecoded.Num();
+			SSSOffsetResult.NumSamples = SSSModeResult.NumSamples = SSSDecoded.Num();
+
+			for (int32 YIndex = 0; YIndex < NumBitsSteps; ++YIndex)
+			{
+				const float Y = YIndex * BitsStepScale;
+				const float ExpectedRange = FMath::FloorToFloat(Y * 0.8f * 8.f) / 8.f;
+				const float ExpectedMode = Y >= 0.5f ? 0.5f : 0.f;
+				for (int32 XIndex = 0; XIndex < NumBitsSteps; ++XIndex)
+				{
+					const float X = XIndex * BitsStepScale;
+					const FVector2D& Spec = SpecDecoded[YIndex * NumBitsSteps + XIndex];
+					const FVector2D& SSS = SSSDecoded[YIndex * NumBitsSteps + XIndex];
+					SpecOffsetResult.AddError(FMath::Abs(Spec.X - FMath::RoundToFloat(X * 31.f) / 31.f));
+					SpecRangeResult.AddError(FMath::Abs(Spec.Y - ExpectedRange));
+					SSSOffsetResult.AddError(FMath::Abs(SSS.X - FMath::RoundToFloat(X * 127.f) / 127.f));
+					SSSModeResult.AddError(FMath::Abs(SSS.Y - ExpectedMode));
+				}
+			}
+		}
+
+		// EncodeColor2D -> GBuffer.CustomData.xy -> DecodeColor2D. A full 10 bit RGB sweep is 2^30 samples, so every channel is sampled at 8 bit at most.
+		{
+			FBenchmarkResult& Result = Report.Add(*FString::Printf(TEXT("Color2D (%d bit)"), FMath::Min(Bits, 8)), Color2DAluOps);
+
+			const int32 NumColorSteps = FMath::Min(NumSteps, 256);
+			const float ColorStepScale = 1.f / (float)(NumColorSteps - 1);
+
+			TArray<FVector> Decoded;
+			Decoded.SetNumUninitialized(NumColorSteps * NumColorSteps * NumColorSteps);
+
+			const double StartTime = FPlatformTime::Seconds();
+			int32 SampleIndex = 0;
+			for (int32 RIndex = 0; RIndex < NumColorSteps; ++RIndex)
+			{
+				for (int32 GIndex = 0; GIndex < NumColorSteps; ++GIndex)
+				{
+					for (int32 BIndex = 0; BIndex < NumColorSteps; ++BIndex)
+					{
+						const FVector2D HV = EncodeColor2D(FVector(RIndex, GIndex, BIndex) * ColorStepScale);
+						Decoded[SampleIndex++] = DecodeColor2D(FVector2D(QuantizeUnorm(HV.X, Bits), QuantizeUnorm(HV.Y, Bits)));
+					}
+				}
+			}
+			Result.Seconds = FPlatformTime::Seconds() - StartTime;
+			Result.NumSamples = Decoded.Num();
+
+			SampleIndex = 0;
+			for (int32 RIndex = 0; RIndex < NumColorSteps; ++RIndex)
+			{
+				for (int32 GIndex = 0; GIndex < NumColorSteps; ++GIndex)
+				{
+					for (int32 BIndex = 0; BIndex < NumColorSteps; ++BIndex)
+					{
+						Result.AddError(MaxAbsError(Decoded[SampleIndex++], FVector(RIndex, GIndex, BIndex) * ColorStepScale));
+					}
+				}
+			}
+		}
+
+		// EncodeUnitVectorToFloat -> DecodeUnitVectorFromFloat, errors are in degrees.
+		// "UnitVector" is the codec on its own, "UnitVector.GBuffer" is the ToonHair path: ShadingModelsMaterial.ush stores
+		// Encode * 0.5 + 0.5 into CustomData.x and ToonHairBxDF decodes CustomData.x without undoing the bias.
+		{
+			FBenchmarkResult& CodecResult = Report.Add(TEXT("UnitVector"), UnitVectorAluOps);
+			FBenchmarkResult& GBufferResult = Report.Add(TEXT("UnitVector.GBuffer"), UnitVectorAluOps + 1);
+
+			TArray<FVector2D> Inputs;
+			Inputs.Reserve(NumSteps * NumSteps);
+			for (int32 YIndex = 0; YIndex < NumSteps; ++YIndex)
+			{
+				for (int32 XIndex = 0; XIndex < NumSteps; ++XIndex)
+				{
+					const FVector2D Input(XIndex * StepScale * 2.f - 1.f, YIndex * StepScale * 2.f - 1.f);
+					if (!Input.IsNearlyZero())
+					{
+						Inputs.Add(Input.GetSafeNormal());
+					}
+				}
+			}
+
+			TArray<FVector2D> Decoded;
+			Decoded.SetNumUninitialized(Inputs.Num());
+
+			double StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+			{
+				Decoded[Index] = DecodeUnitVectorFromFloat(EncodeUnitVectorToFloat(Inputs[Index]));
+			}
+			CodecResult.Seconds = FPlatformTime::Seconds() - StartTime;
+			CodecResult.NumSamples = Inputs.Num();
+
+			for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+			{
+				CodecResult.AddError(AngleErrorDegrees(Decoded[Index], Inputs[Index]));
+			}
+
+			StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+			{
+				Decoded[Index] = DecodeUnitVectorFromFloat(QuantizeUnorm(EncodeUnitVectorToFloat(Inputs[Index]) * 0.5f + 0.5f, Bits));
+			}
+			GBufferResult.Seconds = FPlatformTime::Seconds() - StartTime;
+			GBufferResult.NumSamples = Inputs.Num();
+
+			for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+			{
+				GBufferResult.AddError(AngleErrorDegrees(Decoded[Index], Inputs[Index]));
+			}
+
+			// Same inputs through the TOON_HAIR_ANGLE_TANGENT codec, which is stored into CustomData.x as is
+			FBenchmarkResult& AngleResult = Report.Add(TEXT("UnitVectorAngle"), UnitVectorAngleAluOps);
+			FBenchmarkResult& AngleGBufferResult = Report.Add(TEXT("UnitVectorAngle.GBuffer"), UnitVectorAngleAluOps);
+
+			StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+			{
+				Decoded[Index] = DecodeUnitVectorFromAngle(EncodeUnitVectorToAngle(Inputs[Index]));
+			}
+			AngleResult.Seconds = FPlatformTime::Seconds() - StartTime;
+			AngleResult.NumSamples = Inputs.Num();
+
+			for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+			{
+				AngleResult.AddError(AngleErrorDegrees(Decoded[Index], Inputs[Index]));
+			}
+
+			StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+			{
+				Decoded[Index] = DecodeUnitVectorFromAngle(QuantizeUnorm(EncodeUnitVectorToAngle(Inputs[Index]), Bits));
+			}
+			AngleGBufferResult.Seconds = FPlatformTime::Seconds() - StartTime;
+			AngleGBufferResult.NumSamples = Inputs.Num();
+
+			for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+			{
+				AngleGBufferResult.AddError(AngleErrorDegrees(Decoded[Index], Inputs[Index]));
+			}
+		}
+	}
+
+	/**
+	 * Compares the baked ramp LUT (ToonRampLUT.h) against ToonStep on a grid 4x denser than the LUT. "ToonRamp.LUT" covers every
+	 * Range, "ToonRamp.LUT.Range>=0.01" leaves out the ramps narrower than a texel where the bilinear fetch cannot follow the step.
+	 */
+	static void RunRampBenchmarks(FBenchmarkReport& Report)
+	{
+		TArray<FFloat16> Texels;
+		BakeToonRampLUT(Texels);
+
+		const int32 NumInputs = (ToonRampLUTSizeX - 1) * 4 + 1;
+		const int32 NumRanges = (ToonRampLUTSizeY - 1) * 4 + 1;
+		const float MinAccurateRange = 0.01f;
+
+		TArray<FVector2D> Inputs;
+		Inputs.SetNumUninitialized(NumInputs * NumRanges);
+		for (int32 RangeIndex = 0; RangeIndex < NumRanges; ++RangeIndex)
+		{
+			for (int32 InputIndex = 0; InputIndex < NumInputs; ++InputIndex)
+			{
+				// X = Range, Y = Input
+				Inputs[RangeIndex * NumInputs + InputIndex] = FVector2D(RangeIndex * ToonRampLUTMaxRange / (NumRanges - 1), (float)InputIndex / (NumInputs - 1));
+			}
+		}
+
+		FBenchmarkResult& StepResult = Report.Add(TEXT("ToonStep"), ToonStepAluOps);
+		FBenchmarkResult& LUTResult = Report.Add(TEXT("ToonRamp.LUT"), ToonRampLUTAluOps);
+		FBenchmarkResult& AccurateLUTResult = Report.AddErrorOnly(TEXT("ToonRamp.LUT.Range>=0.01"));
+
+		TArray<float> Reference;
+		TArray<float> Sampled;
+		Reference.SetNumUninitialized(Inputs.Num());
+		Sampled.SetNumUninitialized(Inputs.Num());
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+		{
+			Reference[Index] = ToonStep(Inputs[Index].X, Inputs[Index].Y);
+		}
+		StepResult.Seconds = FPlatformTime::Seconds() - StartTime;
+		StepResult.NumSamples = Inputs.Num();
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+		{
+			Sampled[Index] = SampleToonRampLUT(Texels, Inputs[Index].X, Inputs[Index].Y);
+		}
+		LUTResult.Seconds = FPlatformTime::Seconds() - StartTime;
+		LUTResult.NumSamples = Inputs.Num();
+
+		for (int32 Index = 0; Index < Inputs.Num(); ++Index)
+		{
+			const double Error = FMath::Abs(Sampled[Index] - Reference[Index]);
+			LUTResult.AddError(Error);
+			if (Inputs[Index].X >= MinAccurateRange)
+			{
+				AccurateLUTResult.AddError(Error);
+				++AccurateLUTResult.NumSamples;
+			}
+		}
+	}
+
+	/** Loads GBufferB from an 8 bit image dump (PNG, BMP...) into BGRA8. Only the alpha channel, the packed shading model ID, is used. */
+	static bool LoadGBufferB(const FString& Filename, TArray<uint8>& OutBGRA, int32& OutWidth, int32& OutHeight)
+	{
+		TArray<uint8> FileData;
+		if (!FFileHelper::LoadFileToArray(FileData, *Filename))
+		{
+			UE_LOG(LogToonShadingBenchmark, Error, TEXT("Failed to read %s"), *Filename);
+			return false;
+		}
+
+		IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+		const EImageFormat ImageFormat = ImageWrapperModule.DetectImageFormat(FileData.GetData(), FileData.Num());
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageFormat != EImageFormat::Invalid ? ImageWrapperModule.CreateImageWrapper(ImageFormat) : nullptr;
+
+		const TArray<uint8>* RawData = nullptr;
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(FileData.GetData(), FileData.Num()) || !ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, RawData))
+		{
+			UE_LOG(LogToonShadingBenchmark, Error, TEXT("%s is not an 8 bit image the image wrapper can decode"), *Filename);
+			return false;
+		}
+
+		OutBGRA = *RawData;
+		OutWidth = ImageWrapper->GetWidth();
+		OutHeight = ImageWrapper->GetHeight();
+		return true;
+	}
+
+	/** Stand in frame when no dump is given: sky, a default lit floor and a toon character made of one blob per toon model. */
+	static void BuildSyntheticGBufferB(int32 Width, int32 Height, TArray<uint8>& OutBGRA)
+	{
+		struct FBlob
+		{
+			float CenterX, CenterY, Radius;
+			uint32 ShadingModelID;
+		};
+		// In fractions of the height, so the character keeps its shape at any aspect ratio
+		const FBlob Blobs[] =
+		{
+			{ 0.50f, 0.55f, 0.22f, ShadingModelID_Toon },
+			{ 0.50f, 0.25f, 0.10f, ShadingModelID_ToonSkin },
+			{ 0.50f, 0.16f, 0.08f, ShadingModelID_ToonHair },
+			{ 0.64f, 0.58f, 0.06f, ShadingModelID_ToonAniso },
+		};
+
+		OutBGRA.SetNumZeroed(Width * Height * 4);
+		for (int32 Y = 0; Y < Height; ++Y)
+		{
+			for (int32 X = 0; X < Width; ++X)
+			{
+				uint32 ShadingModelID = Y < Height * 3 / 10 ? ShadingModelID_Unlit : 1;
+				for (const FBlob& Blob : Blobs)
+				{
+					const float DX = (X - Blob.CenterX * Width) / Height;
+					const float DY = (float)Y / Height - Blob.CenterY;
+					if (DX * DX + DY * DY < Blob.Radius * Blob.Radius)
+					{
+						ShadingModelID = Blob.ShadingModelID;
+					}
+				}
+				OutBGRA[(Y * Width + X) * 4 + 3] = (uint8)ShadingModelID;
+			}
+		}
+	}
+
+	/** Runs the classifier over a GBufferB dump and logs how the tiles and lit pixels split between the specialized light shaders. */
+	static bool RunTileBenchmarks(const FString& GBufferFilename, FBenchmarkReport& Report)
+	{
+		TArray<uint8> BGRA;
+		int32 Width = 1920;
+		int32 Height = 1080;
+		if (GBufferFilename.IsEmpty())
+		{
+			UE_LOG(LogToonShadingBenchmark, Display, TEXT("No -GBuffer= given, classifying a synthetic %dx%d frame."), Width, Height);
+			BuildSyntheticGBufferB(Width, Height, BGRA);
+		}
+		else if (!LoadGBufferB(GBufferFilename, BGRA, Width, Height))
+		{
+			return false;
+		}
+
+		FBenchmarkResult& Result = Report.Add(TEXT("TileClassification"), 0);
+
+		FToonTileClassification Classification;
+		const double StartTime = FPlatformTime::Seconds();
+		ClassifyToonTiles(&BGRA[3], Width, Height, 4, Width * 4, Classification);
+		Result.Seconds = FPlatformTime::Seconds() - StartTime;
+		Result.NumSamples = (int64)Width * Height;
+
+		const int32 NumTiles = Classification.GetNumTiles();
+		UE_LOG(LogToonShadingBenchmark, Display, TEXT("%dx%d, %d tiles of %dx%d, %d empty"), Width, Height, NumTiles, ToonTileSize, ToonTileSize, Classification.NumEmptyTiles);
+		UE_LOG(LogToonShadingBenchmark, Display, TEXT("%-12s %10s %10s %14s %12s"), TEXT("Class"), TEXT("Tiles"), TEXT("Tiles%"), TEXT("LitPixels"), TEXT("Occupancy%"));
+		for (int32 TileClass = 0; TileClass < (int32)EToonTileClass::Num; ++TileClass)
+		{
+			const int32 NumClassTiles = Classification.TileLists[TileClass].Num();
+			// How much of the drawn tile area is lit pixels of that class, the rest is edge or unlit pixels the light shader skips
+			const int64 DrawnPixels = (int64)NumClassTiles * ToonTileSize * ToonTileSize;
+			UE_LOG(LogToonShadingBenchmark, Display, TEXT("%-12s %10d %10.2f %14lld %12.2f"),
+				GetToonTileClassName((EToonTileClass)TileClass),
+				NumClassTiles,
+				NumTiles > 0 ? 100.0 * NumClassTiles / NumTiles : 0.0,
+				Classification.NumLitPixels[TileClass],
+				DrawnPixels > 0 ? 100.0 * Classification.NumLitPixels[TileClass] / DrawnPixels : 0.0);
+		}
+
+		// Divergence of IntegrateBxDF in the untiled (or MIXED tile) light pass, plain switch vs TOON_SCALARIZE_BXDF_DISPATCH
+		UE_LOG(LogToonShadingBenchmark, Display, TEXT("%-8s %10s %10s %12s %12s %14s %16s"), TEXT("Wave"), TEXT("Waves"), TEXT("Uniform%"), TEXT("BxDF/Wave"), TEXT("LaneUtil%"), TEXT("SwitchVOps"), TEXT("ScalarizedVOps"));
+		for (int32 WaveSize : { 32, 64 })
+		{
+			FBenchmarkResult& WaveResult = Report.Add(*FString::Printf(TEXT("WaveBxDFDispatch.Wave%d"), WaveSize), 0);
+
+			FWaveBxDFDispatchStats Stats;
+			const double WaveStartTime = FPlatformTime::Seconds();
+			SimulateWaveBxDFDispatch(&BGRA[3], Width, Height, 4, Width * 4, WaveSize, Stats);
+			WaveResult.Seconds = FPlatformTime::Seconds() - WaveStartTime;
+			WaveResult.NumSamples = (int64)Width * Height;
+
+			UE_LOG(LogToonShadingBenchmark, Display, TEXT("%-8d %10lld %10.2f %12.3f %12.2f %14lld %16lld"),
+				WaveSize,
+				Stats.NumWaves,
+				Stats.NumWaves > 0 ? 100.0 * Stats.NumUniformWaves / Stats.NumWaves : 0.0,
+				Stats.NumWaves > 0 ? (double)Stats.NumBxDFPasses / Stats.NumWaves : 0.0,
+				100.0 * Stats.GetLaneUtilization(),
+				Stats.GetSwitchVectorOps(),
+				Stats.GetScalarizedVectorOps());
+		}
+		return true;
+	}
+
+	/** Plausible ToonHair inputs: unit vectors with N facing V, colors and GBuffer channels in [0, 1]. */
+	static void BuildHairSamples(int32 NumSamples, FToonHairShadingBatch& OutBatch, TArray<float>& OutEncodedNormals, TArray<float>& OutAngleEncodedNormals)
+	{
+		FRandomStream RandomStream(0x7001);
+		OutBatch.SetNumUninitialized(NumSamples);
+		OutEncodedNormals.SetNumUninitialized(NumSamples);
+		OutAngleEncodedNormals.SetNumUninitialized(NumSamples);
+
+		for (int32 Index = 0; Index < NumSamples; ++Index)
+		{
+			const FVector N = RandomStream.GetUnitVector();
+			FVector V = RandomStream.GetUnitVector();
+			if (FVector::DotProduct(N, V) < 0.f)
+			{
+				V = -V;
+			}
+			const FVector L = RandomStream.GetUnitVector();
+
+			FToonGBufferData GBuffer = FToonGBufferData();
+			// Every other sample uses the deferred light pass setup, where N is GBuffer.WorldNormal and the anisotropic X direction is 0
+			GBuffer.WorldNormal = (Index & 1) ? N : (N + RandomStream.GetUnitVector() * 0.25f).GetSafeNormal();
+			GBuffer.BaseColor = FVector(RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand());
+			GBuffer.Metallic = RandomStream.FRand();
+			GBuffer.DiffuseColor = GBuffer.BaseColor * (1.f - GBuffer.Metallic);
+			GBuffer.SpecularColor = FMath::Lerp(FVector(0.04f), GBuffer.BaseColor, GBuffer.Metallic);
+			GBuffer.Roughness = RandomStream.FRand();
+			GBuffer.CustomData = FVector4(0.f, RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand());
+			GBuffer.ShadingModelID = ShadingModelID_ToonHair;
+
+			OutBatch.SetSample(Index, GBuffer, N, V, L, RandomStream.FRand());
+			const FVector2D Tangent(RandomStream.FRand() * 2.f - 1.f, RandomStream.FRand() * 2.f - 1.f);
+			OutEncodedNormals[Index] = EncodeUnitVectorToFloat(Tangent);
+			OutAngleEncodedNormals[Index] = EncodeUnitVectorToAngle(Tangent);
+		}
+	}
+
+	/** Times Function(Index) over NumSamples samples into Result. */
+	template <typename FunctionType>
+	static void TimeSubTerm(FBenchmarkResult& Result, int32 NumSamples, FunctionType&& Function)
+	{
+		float Sum = 0.f;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < NumSamples; ++Index)
+		{
+			Sum += Function(Index);
+		}
+		Result.Seconds = FPlatformTime::Seconds() - StartTime;
+		Result.NumSamples = NumSamples;
+
+		// Keeps the loop from being optimized away
+		volatile float Sink = Sum;
+		(void)Sink;
+	}
+
+	/**
+	 * ToonHairBxDF: scalar reference and batch evaluator over the same samples, the batch error being measured against the
+	 * reference. The sub-term rows time the expensive pieces of the BxDF on their own, on the inputs the BxDF gives them.
+	 */
+	static void RunHairBenchmarks(FBenchmarkReport& Report)
+	{
+		const int32 NumSamples = 1 << 18;
+		const FVector FalloffColor(1.f, 0.9f, 0.8f);
+
+		FToonHairShadingBatch Batch;
+		TArray<float> EncodedNormals;
+		TArray<float> AngleEncodedNormals;
+		BuildHairSamples(NumSamples, Batch, EncodedNormals, AngleEncodedNormals);
+
+		FBenchmarkResult& ScalarResult = Report.Add(TEXT("ToonHair.Scalar"), 0);
+		FBenchmarkResult& BatchResult = Report.Add(TEXT("ToonHair.Batch"), 0);
+
+		TArray<FToonGBufferData> GBuffers;
+		TArray<FVector> Normals, Views, Lights;
+		TArray<float> Falloffs;
+		GBuffers.SetNumUninitialized(NumSamples);
+		Normals.SetNumUninitialized(NumSamples);
+		Views.SetNumUninitialized(NumSamples);
+		Lights.SetNumUninitialized(NumSamples);
+		Falloffs.SetNumUninitialized(NumSamples);
+		for (int32 Index = 0; Index < NumSamples; ++Index)
+		{
+			Batch.GetSample(Index, GBuffers[Index], Normals[Index], Views[Index], Lights[Index], Falloffs[Index]);
+		}
+
+		TArray<FToonDirectLighting> Reference;
+		Reference.SetNumUninitialized(NumSamples);
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < NumSamples; ++Index)
+		{
+			Reference[Index] = ToonHairBxDF(GBuffers[Index], Normals[Index], Views[Index], Lights[Index], Falloffs[Index], FalloffColor);
+		}
+		ScalarResult.Seconds = FPlatformTime::Seconds() - StartTime;
+		ScalarResult.NumSamples = NumSamples;
+
+		FToonDirectLightingBatch Lighting;
+		StartTime = FPlatformTime::Seconds();
+		EvaluateToonHairBxDFBatch(Batch, FalloffColor, Lighting);
+		BatchResult.Seconds = FPlatformTime::Seconds() - StartTime;
+		BatchResult.NumSamples = NumSamples;
+
+		for (int32 Index = 0; Index < NumSamples; ++Index)
+		{
+			const FToonDirectLighting Evaluated = Lighting.GetSample(Index);
+			BatchResult.AddError(FMath::Max3(
+				MaxAbsError(Evaluated.Diffuse, Reference[Index].Diffuse),
+				MaxAbsError(Evaluated.Specular, Reference[Index].Specular),
+				MaxAbsError(Evaluated.Transmission, Reference[Index].Transmission)));
+		}
+
+		// Sub-term inputs, computed the way ToonHairBxDF does
+		TArray<FVector> HalfVectors, XVectors;
+		TArray<FVector2D> LobeRoughness;
+		HalfVectors.SetNumUninitialized(NumSamples);
+		XVectors.SetNumUninitialized(NumSamples);
+		LobeRoughness.SetNumUninitialized(NumSamples);
+		for (int32 Index = 0; Index < NumSamples; ++Index)
+		{
+			const float SpecularTightness = GetToonHairSpecularTightness(GBuffers[Index].CustomData.Z);
+			const float SpecTA = FMath::Lerp(2.f, 16.f, SpecularTightness);
+			HalfVectors[Index] = (Views[Index] + Lights[Index]).GetUnsafeNormal();
+			XVectors[Index] = FVector::CrossProduct(Normals[Index], GBuffers[Index].WorldNormal);
+			LobeRoughness[Index] = FVector2D(Saturate((1.5f - SpecularTightness) / SpecTA), Saturate((1.f - SpecularTightness) / SpecTA));
+		}
+
+		TimeSubTerm(Report.Add(TEXT("ToonHair.D_GGXaniso"), 0), NumSamples, [&](int32 Index)
+		{
+			const FVector& H = HalfVectors[Index];
+			return D_GGXaniso(LobeRoughness[Index].X, LobeRoughness[Index].Y, Saturate(FVector::DotProduct(Normals[Index], H)), H, XVectors[Index], Normals[Index]);
+		});
+		TimeSubTerm(Report.Add(TEXT("ToonHair.ToonStep"), 0), NumSamples, [&](int32 Index)
+		{
+			return ToonStep(Saturate(GBuffers[Index].Roughness), Falloffs[Index]);
+		});
+		TimeSubTerm(Report.Add(TEXT("ToonHair.Pow1.5"), 0), NumSamples, [&](int32 Index)
+		{
+			return Pow1_5(FalloffColor * GBuffers[Index].BaseColor * 4.f).X;
+		});
+		TimeSubTerm(Report.Add(TEXT("ToonHair.SqrtBaseColor"), 0), NumSamples, [&](int32 Index)
+		{
+			return Sqrt(GBuffers[Index].BaseColor).X;
+		});
+		// Dead in the shader, see ToonHairBxDF
+		TimeSubTerm(Report.Add(TEXT("ToonHair.UnitVectorDecode"), 0), NumSamples, [&](int32 Index)
+		{
+			return OctahedronToUnitVector(DecodeUnitVectorFromFloat(EncodedNormals[Index])).X;
+		});
+		TimeSubTerm(Report.Add(TEXT("ToonHair.UnitVectorDecode.Angle"), 0), NumSamples, [&](int32 Index)
+		{
+			return OctahedronToUnitVector(DecodeUnitVectorFromAngle(AngleEncodedNormals[Index])).X;
+		});
+	}
+
+	/** The shading model part of IsPropertyActive_Internal before MaterialPropertyShadingModels, one list per query. */
+	static bool IsReadByShadingModelsReference(EMaterialProperty Property, const FMaterialShadingModelField& ShadingModels)
+	{
+		switch (Property)
+		{
+		case MP_SubsurfaceColor:	return ShadingModels.HasAnyShadingModel({ MSM_Subsurface, MSM_PreintegratedSkin, MSM_TwoSidedFoliage, MSM_Cloth });
+		case MP_CustomData0:		return ShadingModels.HasAnyShadingModel({ MSM_ClearCoat, MSM_Hair, MSM_Cloth, MSM_Eye, MSM_Toon, MSM_ToonSkin, MSM_ToonHair, MSM_ToonAniso, MSM_Anisotropic });
+		case MP_CustomData1:		return ShadingModels.HasAnyShadingModel({ MSM_ClearCoat, MSM_Eye, MSM_Toon, MSM_ToonSkin, MSM_ToonHair, MSM_ToonAniso, MSM_Anisotropic });
+		case MP_SpecularOffset:		return ShadingModels.HasAnyShadingModel({ MSM_Toon, MSM_ToonHair, MSM_ToonAniso, MSM_ToonSkin });
+		case MP_SpecularRange:		return ShadingModels.HasAnyShadingModel({ MSM_Toon, MSM_ToonSkin });
+		case MP_ShadowColor:		return ShadingModels.HasAnyShadingModel({ MSM_ToonSkin, MSM_ToonAniso, MSM_Anisotropic });
+		default:					return ShadingModels.IsValid();
+		}
+	}
+
+	/** Every property against every valid shading model field, list based reference against the mask table. */
+	static void RunPropertyMaskBenchmarks(FBenchmarkReport& Report)
+	{
+		FBenchmarkResult& ReferenceResult = Report.Add(TEXT("PropertyActive.HasAnyShadingModel"), 0);
+		FBenchmarkResult& TableResult = Report.Add(TEXT("PropertyActive.MaskTable"), 0);
+
+		TArray<FMaterialShadingModelField> ShadingModelFields;
+		// 64 bit counter, a uint32 one would never pass AllShadingModels once MSM_NUM reaches 32
+		for (uint64 Field = 1; Field < (1ull << MSM_NUM); ++Field)
+		{
+			FMaterialShadingModelField& ShadingModels = ShadingModelFields.AddDefaulted_GetRef();
+			for (uint32 ShadingModel = 0; ShadingModel < MSM_NUM; ++ShadingModel)
+			{
+				if (Field & (1ull << ShadingModel))
+				{
+					ShadingModels.AddShadingModel((EMaterialShadingModel)ShadingModel);
+				}
+			}
+		}
+
+		const int64 NumQueries = (int64)ShadingModelFields.Num() * MP_MAX;
+		TBitArray<> Reference(false, NumQueries);
+		TBitArray<> Table(false, NumQueries);
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 FieldIndex = 0; FieldIndex < ShadingModelFields.Num(); ++FieldIndex)
+		{
+			for (int32 Property = 0; Property < MP_MAX; ++Property)
+			{
+				Reference[FieldIndex * MP_MAX + Property] = IsReadByShadingModelsReference((EMaterialProperty)Property, ShadingModelFields[FieldIndex]);
+			}
+		}
+		ReferenceResult.Seconds = FPlatformTime::Seconds() - StartTime;
+		ReferenceResult.NumSamples = NumQueries;
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 FieldIndex = 0; FieldIndex < ShadingModelFields.Num(); ++FieldIndex)
+		{
+			for (int32 Property = 0; Property < MP_MAX; ++Property)
+			{
+				Table[FieldIndex * MP_MAX + Property] = MaterialPropertyShadingModels::IsReadByShadingModels((EMaterialProperty)Property, ShadingModelFields[FieldIndex]);
+			}
+		}
+		TableResult.Seconds = FPlatformTime::Seconds() - StartTime;
+		TableResult.NumSamples = NumQueries;
+
+		// A mismatch is an error of 1, so MeanError is the fraction of queries the table gets wrong
+		for (int64 Index = 0; Index < NumQueries; ++Index)
+		{
+			TableResult.AddError(Reference[Index] != Table[Index] ? 1.0 : 0.0);
+		}
+	}
+}
+
+namespace ToonShadingBenchmark
+{
+	/** Background-like bake input: toon, skin, hair and aniso texels on a 100m square lit by a sun, point lights and spot lights. */
+	static void BuildBakeInputs(int32 NumTexels, int32 NumLights, FToonBakeTexels& OutTexels, TArray<FToonBakeLight>& OutLights)
+	{
+		FRandomStream RandomStream(0x7016);
+		const uint32 ShadingModels[] = { ShadingModelID_Toon, ShadingModelID_Toon, ShadingModelID_ToonSkin, ShadingModelID_ToonHair, ShadingModelID_ToonAniso };
+
+		OutTexels.SetNumUninitialized(NumTexels);
+		for (int32 Index = 0; Index < NumTexels; ++Index)
+		{
+			const FVector WorldPosition(RandomStream.FRandRange(-5000.f, 5000.f), RandomStream.FRandRange(-5000.f, 5000.f), RandomStream.FRandRange(0.f, 500.f));
+			FToonGBufferData GBuffer = FToonGBufferData();
+			GBuffer.WorldNormal = RandomStream.GetUnitVector();
+			GBuffer.BaseColor = FVector(RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand());
+			GBuffer.Metallic = RandomStream.FRand() * 0.2f;
+			GBuffer.Specular = 0.5f;
+			GBuffer.StoredMetallic = RandomStream.FRand();
+			GBuffer.DiffuseColor = GBuffer.BaseColor * (1.f - GBuffer.Metallic);
+			GBuffer.SpecularColor = FMath::Lerp(FVector(0.04f), GBuffer.BaseColor, GBuffer.Metallic);
+			GBuffer.Roughness = RandomStream.FRand();
+			GBuffer.GBufferAO = RandomStream.FRand();
+			GBuffer.CustomData = FVector4(RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand());
+			GBuffer.ShadingModelID = ShadingModels[Index % ARRAY_COUNT(ShadingModels)];
+
+			FVector View = RandomStream.GetUnitVector();
+			if (FVector::DotProduct(View, GBuffer.WorldNormal) < 0.f)
+			{
+				View = -View;
+			}
+			OutTexels.SetTexel(Index, WorldPosition, View, RandomStream.FRand(), GBuffer);
+		}
+
+		OutLights.SetNum(NumLights);
+		for (int32 LightIndex = 0; LightIndex < NumLights; ++LightIndex)
+		{
+			FToonBakeLight& Light = OutLights[LightIndex];
+			Light.Color = FVector(RandomStream.FRand(), RandomStream.FRand(), RandomStream.FRand()) * 10.f;
+			if (LightIndex == 0)
+			{
+				Light.Direction = FVector(0.3f, 0.2f, 1.f).GetSafeNormal();
+				continue;
+			}
+			Light.bRadialLight = true;
+			Light.bInverseSquared = (LightIndex & 1) != 0;
+			Light.Position = FVector(RandomStream.FRandRange(-5000.f, 5000.f), RandomStream.FRandRange(-5000.f, 5000.f), RandomStream.FRandRange(100.f, 1000.f));
+			Light.InvRadius = 1.f / RandomStream.FRandRange(500.f, 4000.f);
+			Light.Color *= Light.bInverseSquared ? 10000.f : 1.f;
+			if (LightIndex % 3 == 0)
+			{
+				// Shining down, Direction points back up towards the light. SpotAngles as FSpotLightSceneProxy fills them
+				const float CosOuterCone = FMath::Cos(FMath::DegreesToRadians(RandomStream.FRandRange(20.f, 60.f)));
+				const float CosInnerCone = FMath::Lerp(CosOuterCone, 1.f, RandomStream.FRand());
+				Light.bSpotLight = true;
+				Light.Direction = (FVector(0.f, 0.f, 1.f) + RandomStream.GetUnitVector() * 0.5f).GetSafeNormal();
+				Light.SpotAngles = FVector2D(CosOuterCone, 1.f / FMath::Max(CosInnerCone - CosOuterCone, 0.01f));
+			}
+		}
+	}
+
+	static void AddBakeErrors(FBenchmarkResult& Result, const FToonBakeLighting& Lighting, const FToonBakeLighting& Reference)
+	{
+		for (int32 Index = 0; Index < Reference.R.Num(); ++Index)
+		{
+			Result.AddError((Lighting.GetTexel(Index) - Reference.GetTexel(Index)).GetAbsMax());
+		}
+	}
+
+	/**
+	 * BakeToonLighting on the calling thread and on the task graph, against a texel by texel loop over GetToonDynamicLighting.
+	 * Samples are texel x light pairs.
+	 */
+	static void RunBakeBenchmarks(int32 NumTexels, int32 NumLights, FBenchmarkReport& Report)
+	{
+		FToonBakeTexels Texels;
+		TArray<FToonBakeLight> Lights;
+		BuildBakeInputs(NumTexels, NumLights, Texels, Lights);
+		const int64 NumSamples = (int64)NumTexels * NumLights;
+
+		FBenchmarkResult& ReferenceResult = Report.Add(TEXT("ToonBake.PerTexel"), 0);
+		FBenchmarkResult& SingleThreadResult = Report.Add(TEXT("ToonBake.Tiles.SingleThread"), 0);
+		FBenchmarkResult& ParallelResult = Report.Add(TEXT("ToonBake.Tiles.Parallel"), 0);
+
+		FToonBakeLighting Reference;
+		double StartTime = FPlatformTime::Seconds();
+		Reference.R.SetNumZeroed(NumTexels);
+		Reference.G.SetNumZeroed(NumTexels);
+		Reference.B.SetNumZeroed(NumTexels);
+		for (int32 Index = 0; Index < NumTexels; ++Index)
+		{
+			FVector Lighting = FVector::ZeroVector;
+			for (const FToonBakeLight& Light : Lights)
+			{
+				Lighting += GetToonDynamicLighting(Texels.GBuffer[Index], Texels.ToonContext[Index],
+					FVector(Texels.PositionX[Index], Texels.PositionY[Index], Texels.PositionZ[Index]),
+					FVector(Texels.ViewX[Index], Texels.ViewY[Index], Texels.ViewZ[Index]),
+					Texels.AmbientOcclusion[Index], Light, 1.f);
+			}
+			Reference.R[Index] = Lighting.X;
+			Reference.G[Index] = Lighting.Y;
+			Reference.B[Index] = Lighting.Z;
+		}
+		ReferenceResult.Seconds = FPlatformTime::Seconds() - StartTime;
+		ReferenceResult.NumSamples = NumSamples;
+
+		// Differences against the reference only come from the order the lights are summed in and the vector square roots and reciprocals
+		FToonBakeLighting SingleThread;
+		StartTime = FPlatformTime::Seconds();
+		BakeToonLighting(Texels, Lights, FToonBakeVisibilityFunction(), SingleThread, true);
+		SingleThreadResult.Seconds = FPlatformTime::Seconds() - StartTime;
+		SingleThreadResult.NumSamples = NumSamples;
+		AddBakeErrors(SingleThreadResult, SingleThread, Reference);
+
+		FToonBakeLighting Parallel;
+		StartTime = FPlatformTime::Seconds();
+		BakeToonLighting(Texels, Lights, FToonBakeVisibilityFunction(), Parallel, false);
+		ParallelResult.Seconds = FPlatformTime::Seconds() - StartTime;
+		ParallelResult.NumSamples = NumSamples;
+		AddBakeErrors(ParallelResult, Parallel, Reference);
+
+		const int32 NumThreads = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+		UE_LOG(LogToonShadingBenchmark, Display, TEXT("%d texels x %d lights, %d threads: %.2fx speedup over one thread (%.0f%% parallel efficiency)"),
+			NumTexels, NumLights, NumThreads,
+			ParallelResult.Seconds > 0.0 ? SingleThreadResult.Seconds / ParallelResult.Seconds : 0.0,
+			ParallelResult.Seconds > 0.0 ? 100.0 * SingleThreadResult.Seconds / (ParallelResult.Seconds * NumThreads) : 0.0);
+	}
+}
+
+UToonShadingBenchmarkCommandlet::UToonShadingBenchmarkCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UToonShadingBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace ToonShadingBenchmark;
+
+	int32 Bits = 8;
+	FParse::Value(*Params, TEXT("Bits="), Bits);
+	if (Bits != 8 && Bits != 10)
+	{
+		UE_LOG(LogToonShadingBenchmark, Error, TEXT("-Bits=%d is not supported, use 8 or 10."), Bits);
+		return 1;
+	}
+
+	const bool bRunCodecs = FParse::Param(*Params, TEXT("Codecs"));
+	const bool bRunRamp = FParse::Param(*Params, TEXT("Ramp"));
+	const bool bRunTiles = FParse::Param(*Params, TEXT("Tiles"));
+	const bool bRunPropertyMasks = FParse::Param(*Params, TEXT("PropertyMasks"));
+	const bool bRunHair = FParse::Param(*Params, TEXT("Hair"));
+	const bool bRunBake = FParse::Param(*Params, TEXT("Bake"));
+	const bool bRunAll = !bRunCodecs && !bRunRamp && !bRunTiles && !bRunPropertyMasks && !bRunHair && !bRunBake;
+
+	FBenchmarkReport Report;
+
+	if (bRunAll || bRunCodecs)
+	{
+		UE_LOG(LogToonShadingBenchmark, Display, TEXT("Running toon GBuffer codec round trips at %d bit..."), Bits);
+		RunCodecBenchmarks(Bits, Report);
+	}
+
+	if (bRunAll || bRunRamp)
+	{
+		UE_LOG(LogToonShadingBenchmark, Display, TEXT("Running toon ramp LUT against ToonStep..."));
+		RunRampBenchmarks(Report);
+	}
+
+	if (bRunAll || bRunTiles)
+	{
+		FString GBufferFilename;
+		FParse::Value(*Params, TEXT("GBuffer="), GBufferFilename);
+
+		UE_LOG(LogToonShadingBenchmark, Display, TEXT("Running toon tile classification..."));
+		if (!RunTileBenchmarks(GBufferFilename, Report))
+		{
+			return 1;
+		}
+	}
+
+	if (bRunAll || bRunPropertyMasks)
+	{
+		UE_LOG(LogToonShadingBenchmark, Display, TEXT("Running material property shading model queries..."));
+		RunPropertyMaskBenchmarks(Report);
+	}
+
+	if (bRunAll || bRunHair)
+	{
+		UE_LOG(LogToonShadingBenchmark, Display, TEXT("Running ToonHairBxDF scalar reference, batch evaluator and sub-terms..."));
+		RunHairBenchmarks(Report);
+	}
+
+	if (bRunAll || bRunBake)
+	{
+		int32 NumTexels = 1 << 16;
+		int32 NumLights = 64;
+		FParse::Value(*Params, TEXT("Texels="), NumTexels);
+		FParse::Value(*Params, TEXT("Lights="), NumLights);
+		NumTexels = FMath::Max(NumTexels, 1);
+		NumLights = FMath::Max(NumLights, 1);
+
+		UE_LOG(LogToonShadingBenchmark, Display, TEXT("Running toon light bake..."));
+		RunBakeBenchmarks(NumTexels, NumLights, Report);
+	}
+
+	Report.Print();
+
+	FString CSVFilename;
+	if (FParse::Value(*Params, TEXT("CSV="), CSVFilename))
+	{
+		if (!Report.SaveCSV(CSVFilename))
+		{
+			UE_LOG(LogToonShadingBenchmark, Error, TEXT("Failed to write %s"), *CSVFilename);
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -16,6 +16,8 @@
 #include "Materials/Material.h"
 #include "Materials/MaterialExpressionMaterialFunctionCall.h"
 #include "Materials/MaterialFunctionInstance.h"
+#include "Materials/MaterialPropertyShadingModels.h"
+#include "Materials/ToonMaterialUniformExpressions.h"
 #include "MaterialCompiler.h"
 #include "RenderUtils.h"
 #include "EngineGlobals.h"
@@ -39,6 +41,7 @@
 #include "Containers/LazyPrintf.h"
 #include "Containers/HashTable.h"
 #include "Engine/Texture2D.h"
+#include "ToonMaterialParameterTable.h"
 #endif
 
 class Error;
@@ -180,6 +183,15 @@ protected:
 	// List of Shared pixel properties. Used to share generated code
 	bool SharedPixelProperties[CompiledMP_MAX];
 
+	/** Stylized shading properties read by the material's shading models. The others get neither code chunks nor getter functions. */
+	bool ActiveToonProperties[CompiledMP_MAX];
+
+	/**
+	 * Uniform expression each property last went through ForceCast with. The cast reads non-constant expressions through an accessor
+	 * chunk, which loses the expression the toon material parameter table is built from.
+	 */
+	TMap<EMaterialProperty, TRefCountPtr<FMaterialUniformExpression>> ForceCastUniformExpressions;
+
 	/* Stack that tracks compiler state specific to the function currently being compiled. */
 	TArray<FMaterialFunctionCompileState*> FunctionStacks[SF_NumFrequencies];
 
@@ -298,6 +310,12 @@ protected:
 	uint32 bIsFullyRough : 1;
 	/** true if allowed to generate code chunks. Translator operates in two phases; generate all code chunks & query meta data based on generated code chunks. */
 	uint32 bAllowCodeChunkGeneration : 1;
+	/** true if the Toon inputs are stored in GToonMaterialParameterTable instead of the GBuffer, see MATERIAL_TOON_PARAMETER_TABLE */
+	uint32 bUsesToonMaterialParameterTable : 1;
+	/** true if the ToonAniso anisotropy (CustomData0) evaluates to a constant 0, see MATERIAL_TOON_ANISO_ISOTROPIC */
+	uint32 bIsToonAnisoIsotropic : 1;
+	/** CustomData channels read back by the lighting passes for the material's shading models, see MATERIAL_CUSTOMDATA_USED_MASK */
+	uint32 CustomDataUsedMask;
 	/** Tracks the number of texture coordinates used by this material. */
 	uint32 NumUserTexCoords;
 	/** Tracks the number of texture coordinates used by the vertex shader in this material. */
@@ -367,6 +385,9 @@ public:
 	,	bUsesDistanceCullFade(false)
 	,	bIsFullyRough(0)
 	,	bAllowCodeChunkGeneration(true)
+	,	bUsesToonMaterialParameterTable(false)
+	,	bIsToonAnisoIsotropic(false)
+	,	CustomDataUsedMask(MaterialPropertyShadingModels::AllCustomData)
 	,	NumUserTexCoords(0)
 	,	NumUserVertexTexCoords(0)
 	,	DynamicParticleParameterMask(0)
@@ -393,6 +414,8 @@ public:
 		SharedPixelProperties[MP_SpecularRange] = true;
 		SharedPixelProperties[MP_ShadowColor] = true;
 
+		FMemory::Memzero(ActiveToonProperties);
+
 		for (int32 Frequency = 0; Frequency < SF_NumFrequencies; ++Frequency)
 		{
 			FunctionStacks[Frequency].Add(new FMaterialFunctionCompileState(nullptr));
@@ -937,10 +960,61 @@ public:
 			Chunk[MP_CustomData1]					= Material->CompilePropertyAndSetMaterialProperty(MP_CustomData1		,this);
 			Chunk[MP_AmbientOcclusion]				= Material->CompilePropertyAndSetMaterialProperty(MP_AmbientOcclusion	,this);
 
-			// Stylized Shading
-			Chunk[MP_SpecularOffset]				= Material->CompilePropertyAndSetMaterialProperty(MP_SpecularOffset, this);
-			Chunk[MP_SpecularRange]					= Material->CompilePropertyAndSetMaterialProperty(MP_SpecularRange, this);
-			Chunk[MP_ShadowColor]					= Material->CompilePropertyAndSetMaterialProperty(MP_ShadowColor, this);
+			// Stylized Shading, skipped entirely for the shading models that do not read them
+			for (EMaterialProperty ToonProperty : { MP_SpecularOffset, MP_SpecularRange, MP_ShadowColor })
+			{
+				ActiveToonProperties[ToonProperty] = Domain == MD_Surface && MaterialPropertyShadingModels::IsReadByShadingModels(ToonProperty, MaterialShadingModels);
+				SharedPixelProperties[ToonProperty] = ActiveToonProperties[ToonProperty];
+
+				if (ActiveToonProperties[ToonProperty])
+				{
+					Chunk[ToonProperty] = Material->CompilePropertyAndSetMaterialProperty(ToonProperty, this);
+				}
+			}
+
+			// Toon inputs known without running the material per pixel go to GToonMaterialParameterTable, and CustomData0 and CustomData1 become the slot there
+			if (Domain == MD_Surface && MaterialShadingModels.HasOnlyShadingModel(MSM_Toon) && IsToonMaterialParameterTableEnabled())
+			{
+				const EMaterialProperty ToonTableProperties[] = { MP_CustomData0, MP_CustomData1, MP_SpecularOffset, MP_SpecularRange };
+				FMaterialUniformExpression* ToonTableExpressions[ARRAY_COUNT(ToonTableProperties)];
+
+				bUsesToonMaterialParameterTable = true;
+				for (int32 Index = 0; Index < ARRAY_COUNT(ToonTableProperties); ++Index)
+				{
+					// Constants keep their expression on the chunk, parameters lost it to the accessor chunk of the final ForceCast
+					const int32 ToonChunk = Chunk[ToonTableProperties[Index]];
+					ToonTableExpressions[Index] = ToonChunk != INDEX_NONE ? GetParameterUniformExpression(ToonChunk) : nullptr;
+					if (ToonChunk != INDEX_NONE && !ToonTableExpressions[Index])
+					{
+						const TRefCountPtr<FMaterialUniformExpression>* CastExpression = ForceCastUniformExpressions.Find(ToonTableProperties[Index]);
+						ToonTableExpressions[Index] = CastExpression ? CastExpression->GetReference() : nullptr;
+					}
+					bUsesToonMaterialParameterTable &= ToonTableExpressions[Index] != nullptr;
+				}
+
+				if (bUsesToonMaterialParameterTable)
+				{
+					// R: CustomData0, G: CustomData1, B: SpecularOffset, A: SpecularRange, see ToonShading::MakeToonMaterialParameters()
+					FMaterialUniformExpression* ToonInputs = new FMaterialUniformExpressionAppendVector(
+						new FMaterialUniformExpressionAppendVector(ToonTableExpressions[0], ToonTableExpressions[1], 1),
+						new FMaterialUniformExpressionAppendVector(ToonTableExpressions[2], ToonTableExpressions[3], 1),
+						2);
+					const int32 ToonMaterialSlot = AddUniformExpression(new FMaterialUniformExpressionToonMaterialSlot(ToonInputs), MCT_Float2, TEXT("ToonMaterialSlot(%s,%s,%s,%s)"),
+						*GetParameterCode(Chunk[MP_CustomData0]), *GetParameterCode(Chunk[MP_CustomData1]), *GetParameterCode(Chunk[MP_SpecularOffset]), *GetParameterCode(Chunk[MP_SpecularRange]));
+
+					// The slot is never constant, reading it through Material.VectorExpressions adds it to the uniform expression set evaluated per proxy
+					const int32 EncodedSlot = ToonMaterialSlot != INDEX_NONE ? AccessUniformExpression(ToonMaterialSlot) : INDEX_NONE;
+					Chunk[MP_CustomData0] = ComponentMask(EncodedSlot, true, false, false, false);
+					Chunk[MP_CustomData1] = ComponentMask(EncodedSlot, false, true, false, false);
+
+					// Only the slot is read by the base pass now
+					for (EMaterialProperty ToonProperty : { MP_SpecularOffset, MP_SpecularRange })
+					{
+						ActiveToonProperties[ToonProperty] = false;
+						SharedPixelProperties[ToonProperty] = false;
+					}
+				}
+			}
 
 			if (IsTranslucentBlendMode(BlendMode))
 			{
@@ -1071,6 +1145,11 @@ ResourcesString = TEXT("");
 			// Fully rough if we have a roughness code chunk and it's constant and evaluates to 1.
 			bIsFullyRough = Chunk[MP_Roughness] != INDEX_NONE && IsMaterialPropertyUsed(MP_Roughness, Chunk[MP_Roughness], FLinearColor(1, 0, 0, 0), 1) == false;
 
+			// Isotropic ToonAniso if the anisotropy is unconnected or a constant 0. Parameters are not folded, they can still be changed by instances.
+			bIsToonAnisoIsotropic = MaterialShadingModels.HasShadingModel(MSM_ToonAniso) && IsMaterialPropertyUsed(MP_CustomData0, Chunk[MP_CustomData0], FLinearColor(0, 0, 0, 0), 1) == false;
+
+			CustomDataUsedMask = GetCustomDataUsedMask(MaterialShadingModels);
+
 			if (BlendMode == BLEND_Modulate && MaterialShadingModels.IsLit() && !Material->IsDeferredDecal())
 			{
 				Errorf(TEXT("Dynamically lit translucency is not supported for BLEND_Modulate materials."));
@@ -1209,6 +1288,7 @@ ResourcesString = TEXT("");
 			}
 
 			// Now the rest, skipping Normal
+			TArray<FFixedParameterCodeRequest> FixedParameterCodeRequests;
 			for(uint32 PropertyId = 0; PropertyId < MP_MAX; ++PropertyId)
 			{
 				if (PropertyId == MP_MaterialAttributes || PropertyId == MP_Normal || PropertyId == MP_CustomOutput)
@@ -1225,13 +1305,7 @@ ResourcesString = TEXT("");
 					StartChunk = NormalCodeChunkEnd;
 				}
 
-				GetFixedParameterCode(
-					StartChunk,
-					SharedPropertyCodeChunks[PropertyShaderFrequency].Num(),
-					Chunk[PropertyId],
-					SharedPropertyCodeChunks[PropertyShaderFrequency],
-					TranslatedCodeChunkDefinitions[PropertyId],
-					TranslatedCodeChunks[PropertyId]);
+				FixedParameterCodeRequests.Add(FFixedParameterCodeRequest(PropertyId, Chunk[PropertyId], SharedPropertyCodeChunks[PropertyShaderFrequency], StartChunk));
 			}
 
 			for(uint32 PropertyId = MP_MAX; PropertyId < CompiledMP_MAX; ++PropertyId)
@@ -1241,12 +1315,12 @@ ResourcesString = TEXT("");
 				case CompiledMP_EmissiveColorCS:
 			    	if (bCompileForComputeShader)
 				    {
-						GetFixedParameterCode(Chunk[PropertyId], SharedPropertyCodeChunks[SF_Compute], TranslatedCodeChunkDefinitions[PropertyId], TranslatedCodeChunks[PropertyId]);
+						FixedParameterCodeRequests.Add(FFixedParameterCodeRequest(PropertyId, Chunk[PropertyId], SharedPropertyCodeChunks[SF_Compute], 0));
 				    }
 					break;
 				case CompiledMP_PrevWorldPositionOffset:
 					{
-						GetFixedParameterCode(Chunk[PropertyId], SharedPropertyCodeChunks[SF_Vertex], TranslatedCodeChunkDefinitions[PropertyId], TranslatedCodeChunks[PropertyId]);
+						FixedParameterCodeRequests.Add(FFixedParameterCodeRequest(PropertyId, Chunk[PropertyId], SharedPropertyCodeChunks[SF_Vertex], 0));
 					}
 					break;
 				default: check(0);
@@ -1254,6 +1328,8 @@ ResourcesString = TEXT("");
 				}
 			}
 
+			GetFixedParameterCodes(FixedParameterCodeRequests);
+
 			// Output the implementation for any custom output expressions
 			for (int32 ExpressionIndex = 0; ExpressionIndex < CustomOutputImplementations.Num(); ExpressionIndex++)
 			{
@@ -1487,6 +1563,7 @@ ResourcesString = TEXT("");
 			if(ShadingModels.HasShadingModel(MSM_Toon))
 			{
 				OutEnvironment.SetDefine(TEXT("MATERIAL_SHADINGMODEL_TOON"), TEXT("1"));
+				OutEnvironment.SetDefine(TEXT("MATERIAL_TOON_PARAMETER_TABLE"), bUsesToonMaterialParameterTable);
 				NumSetMaterials++;
 			}
 			if(ShadingModels.HasShadingModel(MSM_ToonSkin))
@@ -1502,6 +1579,7 @@ ResourcesString = TEXT("");
 			if(ShadingModels.HasShadingModel(MSM_ToonAniso))
 			{
 				OutEnvironment.SetDefine(TEXT("MATERIAL_SHADINGMODEL_TOON_ANISO"), TEXT("1"));
+				OutEnvironment.SetDefine(TEXT("MATERIAL_TOON_ANISO_ISOTROPIC"), bIsToonAnisoIsotropic);
 				NumSetMaterials++;
 			}
 			if(ShadingModels.HasShadingModel(MSM_Anisotropic))
@@ -1515,6 +1593,8 @@ ResourcesString = TEXT("");
 				OutEnvironment.SetDefine(TEXT("MATERIAL_SINGLE_SHADINGMODEL"), TEXT("1"));
 			}
 
+			OutEnvironment.SetDefine(TEXT("MATERIAL_CUSTOMDATA_USED_MASK"), CustomDataUsedMask);
+
 			ensure(NumSetMaterials != 0);
 			if (NumSetMaterials == 0)
 			{
@@ -1648,9 +1728,10 @@ ResourcesString = TEXT("");
 		LazyPrintf.PushParam(*GenerateFunctionCode(MP_CustomData0));
 		LazyPrintf.PushParam(*GenerateFunctionCode(MP_CustomData1));
 		// Stylized Shading
-		LazyPrintf.PushParam(*GenerateFunctionCode(MP_SpecularOffset));
-		LazyPrintf.PushParam(*GenerateFunctionCode(MP_SpecularRange));
-		LazyPrintf.PushParam(*GenerateFunctionCode(MP_ShadowColor));
+		LazyPrintf.PushParam(*(
+			GenerateToonFunctionCode(MP_SpecularOffset, TEXT("half GetMaterialSpecularOffset")) +
+			GenerateToonFunctionCode(MP_SpecularRange, TEXT("half GetMaterialSpecularRange")) +
+			GenerateToonFunctionCode(MP_ShadowColor, TEXT("float3 GetMaterialShadowcolor"))));
 
 		// Print custom texture coordinate assignments
 		FString CustomUVAssignments;
@@ -1726,6 +1807,36 @@ ResourcesString = TEXT("");
 
 protected:
 
+	/** Union of the CustomData channels the lighting passes read for each of ShadingModels, once the material is translated. */
+	uint32 GetCustomDataUsedMask(const FMaterialShadingModelField& ShadingModels) const
+	{
+		using namespace MaterialPropertyShadingModels;
+
+		uint32 UsedMask = 0;
+		for (int32 ShadingModelIndex = 0; ShadingModelIndex < MSM_NUM; ++ShadingModelIndex)
+		{
+			const EMaterialShadingModel ShadingModel = (EMaterialShadingModel)ShadingModelIndex;
+			if (!ShadingModels.HasShadingModel(ShadingModel))
+			{
+				continue;
+			}
+
+			uint32 ShadingModelMask = GetCustomDataChannelMask(ShadingModel);
+			if (ShadingModel == MSM_Toon && bUsesToonMaterialParameterTable)
+			{
+				// Only the slot, GetToonLightingContext finds the rest in the table
+				ShadingModelMask = CustomDataX | CustomDataY;
+			}
+			else if (ShadingModel == MSM_ToonAniso && bIsToonAnisoIsotropic)
+			{
+				// No tangent
+				ShadingModelMask = CustomDataZ | CustomDataW;
+			}
+			UsedMask |= ShadingModelMask;
+		}
+		return UsedMask;
+	}
+
 	bool IsMaterialPropertyUsed(EMaterialProperty Property, int32 PropertyChunkIndex, const FLinearColor& ReferenceValue, int32 NumComponents)
 	{
 		bool bPropertyUsed = false;
@@ -1770,6 +1881,17 @@ protected:
 		return TranslatedCodeChunkDefinitions[Index] + TEXT("	return ") + TranslatedCodeChunks[Index] + TEXT(";");
 	}
 
+	/** Whole getter function of a stylized shading property, or nothing when the material's shading models do not read the property. */
+	FString GenerateToonFunctionCode(EMaterialProperty Property, const TCHAR* FunctionDeclaration) const
+	{
+		if (!ActiveToonProperties[Property])
+		{
+			return FString();
+		}
+		return FString::Printf(TEXT("%s(FMaterialPixelParameters Parameters)") LINE_TERMINATOR TEXT("{") LINE_TERMINATOR TEXT("%s") LINE_TERMINATOR TEXT("}") LINE_TERMINATOR LINE_TERMINATOR,
+			FunctionDeclaration, *GenerateFunctionCode(Property));
+	}
+
 	// GetParameterCode
 	virtual FString GetParameterCode(int32 Index, const TCHAR* Default = 0)
 	{
@@ -1830,7 +1952,7 @@ protected:
 	}
 
 	/** Creates a string of all definitions needed for the given material input. */
-	FString GetDefinitions(TArray<FShaderCodeChunk>& CodeChunks, int32 StartChunk, int32 EndChunk) const
+	FString GetDefinitions(const TArray<FShaderCodeChunk>& CodeChunks, int32 StartChunk, int32 EndChunk) const
 	{
 		FString Definitions;
 		for (int32 ChunkIndex = StartChunk; ChunkIndex < EndChunk; ChunkIndex++)
@@ -1878,6 +2000,101 @@ protected:
 		GetFixedParameterCode(0, CodeChunks.Num(), ResultIndex, CodeChunks, OutDefinitions, OutValue);
 	}
 
+	/** Code chunks whose definitions a property function starts with. */
+	struct FDefinitionsRange
+	{
+		const TArray<FShaderCodeChunk>* CodeChunks;
+		int32 StartChunk;
+		int32 EndChunk;
+
+		bool operator==(const FDefinitionsRange& Other) const
+		{
+			return CodeChunks == Other.CodeChunks && StartChunk == Other.StartChunk && EndChunk == Other.EndChunk;
+		}
+
+		friend uint32 GetTypeHash(const FDefinitionsRange& Range)
+		{
+			return HashCombine(PointerHash(Range.CodeChunks), HashCombine(GetTypeHash(Range.StartChunk), GetTypeHash(Range.EndChunk)));
+		}
+	};
+
+	/** GetFixedParameterCode of a property into TranslatedCodeChunkDefinitions and TranslatedCodeChunks, up to the end of its chunks. */
+	struct FFixedParameterCodeRequest
+	{
+		uint32 PropertyId;
+		int32 ResultIndex;
+		FDefinitionsRange Range;
+
+		FFixedParameterCodeRequest(uint32 InPropertyId, int32 InResultIndex, const TArray<FShaderCodeChunk>& CodeChunks, int32 StartChunk)
+			: PropertyId(InPropertyId)
+			, ResultIndex(InResultIndex)
+		{
+			Range.CodeChunks = &CodeChunks;
+			Range.StartChunk = StartChunk;
+			Range.EndChunk = CodeChunks.Num();
+		}
+	};
+
+	/**
+	 * Same as calling GetFixedParameterCode for each request, once code chunk generation is over.
+	 * The unshared properties of a frequency all start with the definitions of every chunk of that frequency, so each distinct range
+	 * is only concatenated once.
+	 */
+	void GetFixedParameterCodes(const TArray<FFixedParameterCodeRequest>& Requests)
+	{
+		check(!bAllowCodeChunkGeneration);
+
+		TArray<FDefinitionsRange> UniqueRanges;
+		TMap<FDefinitionsRange, int32> UniqueRangeIndices;
+		TArray<int32, TInlineAllocator<MP_MAX>> RequestRangeIndices;
+		RequestRangeIndices.Init(INDEX_NONE, Requests.Num());
+
+		for (int32 RequestIndex = 0; RequestIndex < Requests.Num(); ++RequestIndex)
+		{
+			const FFixedParameterCodeRequest& Request = Requests[RequestIndex];
+			FString& OutValue = TranslatedCodeChunks[Request.PropertyId];
+
+			if (Request.ResultIndex == INDEX_NONE)
+			{
+				OutValue = TEXT("0");
+				continue;
+			}
+
+			const TArray<FShaderCodeChunk>& CodeChunks = *Request.Range.CodeChunks;
+			checkf(Request.ResultIndex >= 0 && Request.ResultIndex < CodeChunks.Num(), TEXT("Index out of range %d/%d [%s]"), Request.ResultIndex, CodeChunks.Num(), *Material->GetFriendlyName());
+			const FShaderCodeChunk& ResultChunk = CodeChunks[Request.ResultIndex];
+			check(!ResultChunk.UniformExpression || ResultChunk.UniformExpression->IsConstant());
+
+			if (ResultChunk.UniformExpression && ResultChunk.UniformExpression->IsConstant())
+			{
+				// Handle a constant uniform expression being the only code chunk hooked up to a material input
+				OutValue = ResultChunk.Definition;
+				continue;
+			}
+
+			check(ResultChunk.bInline || ResultChunk.SymbolName.Len() > 0);
+			OutValue = ResultChunk.bInline ? ResultChunk.Definition : ResultChunk.SymbolName;
+
+			const int32* ExistingRangeIndex = UniqueRangeIndices.Find(Request.Range);
+			RequestRangeIndices[RequestIndex] = ExistingRangeIndex ? *ExistingRangeIndex : UniqueRangeIndices.Add(Request.Range, UniqueRanges.Add(Request.Range));
+		}
+
+		TArray<FString> UniqueDefinitions;
+		UniqueDefinitions.Reserve(UniqueRanges.Num());
+		for (const FDefinitionsRange& Range : UniqueRanges)
+		{
+			UniqueDefinitions.Add(GetDefinitions(*Range.CodeChunks, Range.StartChunk, Range.EndChunk));
+		}
+
+		for (int32 RequestIndex = 0; RequestIndex < Requests.Num(); ++RequestIndex)
+		{
+			if (RequestRangeIndices[RequestIndex] != INDEX_NONE)
+			{
+				TranslatedCodeChunkDefinitions[Requests[RequestIndex].PropertyId] = UniqueDefinitions[RequestRangeIndices[RequestIndex]];
+			}
+		}
+	}
+
 	/** Used to get a user friendly type from EMaterialValueType */
 	const TCHAR* DescribeType(EMaterialValueType Type) const
 	{
@@ -2855,9 +3072,14 @@ protected:
 
 		if(GetParameterUniformExpression(Code) && !GetParameterUniformExpression(Code)->IsConstant())
 		{
-			return ForceCast(AccessUniformExpression(Code),DestType,ForceCastFlags);
+			const int32 AccessedCode = ForceCast(AccessUniformExpression(Code),DestType,ForceCastFlags);
+			ForceCastUniformExpressions.Add(MaterialProperty, GetParameterUniformExpression(Code));
+			return AccessedCode;
 		}
 
+		// The last cast of a property is the one FMaterialResource::CompilePropertyAndSetMaterialProperty applies to its result
+		ForceCastUniformExpressions.Add(MaterialProperty, GetParameterUniformExpression(Code));
+
 		EMaterialValueType	SourceType = GetParameterType(Code);
 
 		bool bExactMatch = (ForceCastFlags & MFCF_ExactMatch) ? true : false;
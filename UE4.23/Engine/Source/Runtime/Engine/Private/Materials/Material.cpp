@@ -17,6 +17,7 @@
 #include "EngineGlobals.h"
 #include "Materials/MaterialInstance.h"
 #include "Materials/MaterialInstanceDynamic.h"
+#include "Materials/MaterialPropertyShadingModels.h"
 #include "UnrealEngine.h"
 #include "Materials/MaterialExpressionCollectionParameter.h"
 #include "Materials/MaterialExpressionCustomOutput.h"
@@ -75,6 +76,7 @@
 #include "Curves/CurveLinearColorAtlas.h"
 #include "HAL/ThreadHeartBeat.h"
 #include "Misc/ScopedSlowTask.h"
+#include "MaterialShaderMapPrefetch.h"
 
 #define LOCTEXT_NAMESPACE "Material"
 
@@ -2860,6 +2862,15 @@ void UMaterial::CacheResourceShadersForRendering(bool bRegenerateId)
 		EMaterialQualityLevel::Type ActiveQualityLevel = GetCachedScalabilityCVars().MaterialQualityLevel;
 		TArray<FMaterialResource*> ResourcesToCache;
 
+#if WITH_EDITOR
+		// Fetch the shader maps of all feature levels in parallel rather than one after the other
+		FMaterialShaderMapPrefetchScope PrefetchScope;
+		if ((FeatureLevelsToCompile & (FeatureLevelsToCompile - 1)) != 0)
+		{
+			PrefetchResourceShadersForRendering();
+		}
+#endif
+
 		while (FeatureLevelsToCompile != 0)
 		{
 			ERHIFeatureLevel::Type FeatureLevel = (ERHIFeatureLevel::Type)FBitSet::GetAndClearNextBit(FeatureLevelsToCompile);
@@ -2957,10 +2968,57 @@ void UMaterial::CacheResourceShadersForCooking(EShaderPlatform ShaderPlatform, T
 	}
 }
 
+#if WITH_EDITOR
+void UMaterial::PrefetchResourceShadersForRendering()
+{
+	if (!FApp::CanEverRender())
+	{
+		return;
+	}
+
+	// Same resources as CacheResourceShadersForRendering
+	uint32 FeatureLevelsToCompile = GetFeatureLevelsToCompileForRendering();
+	const EMaterialQualityLevel::Type ActiveQualityLevel = GetCachedScalabilityCVars().MaterialQualityLevel;
+
+	while (FeatureLevelsToCompile != 0)
+	{
+		const ERHIFeatureLevel::Type FeatureLevel = (ERHIFeatureLevel::Type)FBitSet::GetAndClearNextBit(FeatureLevelsToCompile);
+		const EShaderPlatform ShaderPlatform = GShaderPlatformForFeatureLevel[FeatureLevel];
+		if (const FMaterialResource* MaterialResource = MaterialResources[ActiveQualityLevel][FeatureLevel])
+		{
+			FMaterialShaderMapPrefetcher::Get().Prefetch(*MaterialResource, ShaderPlatform);
+		}
+		else
+		{
+			// Not allocated yet, e.g. before the first cache after PostLoad. Set up a temporary resource the way
+			// UpdateResourceAllocations will set up the real one, so that it has the same shader map id
+			TArray<bool, TInlineAllocator<EMaterialQualityLevel::Num> > QualityLevelsUsed;
+			GetQualityLevelUsage(QualityLevelsUsed, ShaderPlatform);
+
+			FMaterialResource TempResource;
+			TempResource.SetMaterial(this, ActiveQualityLevel, QualityLevelsUsed[ActiveQualityLevel], FeatureLevel);
+			FMaterialShaderMapPrefetcher::Get().Prefetch(TempResource, ShaderPlatform);
+		}
+	}
+}
+#endif // WITH_EDITOR
+
 void UMaterial::CacheShadersForResources(EShaderPlatform ShaderPlatform, const TArray<FMaterialResource*>& ResourcesToCache, const ITargetPlatform* TargetPlatform)
 {
 	RebuildExpressionTextureReferences();
 
+#if WITH_EDITOR
+	// Cooking caches every quality level at once
+	FMaterialShaderMapPrefetchScope PrefetchScope;
+	if (ResourcesToCache.Num() > 1)
+	{
+		for (const FMaterialResource* Resource : ResourcesToCache)
+		{
+			FMaterialShaderMapPrefetcher::Get().Prefetch(*Resource, ShaderPlatform);
+		}
+	}
+#endif
+
 	for (int32 ResourceIndex = 0; ResourceIndex < ResourcesToCache.Num(); ResourceIndex++)
 	{
 		FMaterialResource* CurrentResource = ResourcesToCache[ResourceIndex];
@@ -5573,9 +5631,27 @@ void UMaterial::AllMaterialsCacheResourceShadersForRendering(bool bUpdateProgres
  		return ((const UMaterial&)L).IsDefaultMaterial() > ((const UMaterial&)R).IsDefaultMaterial();
 	});
 
-	for (UObject* MaterialObj : MaterialArray)
+#if WITH_EDITOR
+	// Keep the DDC busy with the shader maps of the next materials while this one is cached.
+	// The window bounds how many payloads wait in memory.
+	const int32 PrefetchWindow = 64;
+	FMaterialShaderMapPrefetchScope PrefetchScope;
+	for (int32 MaterialIndex = 0; MaterialIndex < FMath::Min(PrefetchWindow, MaterialArray.Num()); ++MaterialIndex)
+	{
+		((UMaterial*)MaterialArray[MaterialIndex])->PrefetchResourceShadersForRendering();
+	}
+#endif // WITH_EDITOR
+
+	for (int32 MaterialIndex = 0; MaterialIndex < MaterialArray.Num(); ++MaterialIndex)
 	{
-		UMaterial* Material = (UMaterial*)MaterialObj;
+		UMaterial* Material = (UMaterial*)MaterialArray[MaterialIndex];
+
+#if WITH_EDITOR
+		if (MaterialArray.IsValidIndex(MaterialIndex + PrefetchWindow))
+		{
+			((UMaterial*)MaterialArray[MaterialIndex + PrefetchWindow])->PrefetchResourceShadersForRendering();
+		}
+#endif // WITH_EDITOR
 
 		Material->CacheResourceShadersForRendering(false);
 
@@ -5904,6 +5980,9 @@ static bool IsPropertyActive_Internal(EMaterialProperty InProperty,
 		|| TranslucencyLightingMode == TLM_VolumetricPerVertexNonDirectional
 		|| TranslucencyLightingMode == TLM_VolumetricPerVertexDirectional;
 
+	// One AND instead of building a shading model list per query, this is called in loops by the editor and the translator
+	const bool bReadByShadingModels = MaterialPropertyShadingModels::IsReadByShadingModels(InProperty, ShadingModels);
+
 	bool Active = true;
 
 	switch (InProperty)
@@ -5929,6 +6008,14 @@ static bool IsPropertyActive_Internal(EMaterialProperty InProperty,
 	case MP_AmbientOcclusion:
 		Active = ShadingModels.IsLit();
 		break;
+	case MP_SubsurfaceColor:
+	case MP_CustomData0:
+	case MP_CustomData1:
+	case MP_SpecularOffset:
+	case MP_SpecularRange:
+	case MP_ShadowColor:
+		Active = bReadByShadingModels;
+		break;
 	case MP_Specular:
 	case MP_Roughness:
 		Active = ShadingModels.IsLit() && (!bIsTranslucentBlendMode || !bIsVolumetricTranslucencyLightingMode);
@@ -5940,15 +6027,6 @@ static bool IsPropertyActive_Internal(EMaterialProperty InProperty,
 	case MP_Normal:
 		Active = (ShadingModels.IsLit() && (!bIsTranslucentBlendMode || !bIsNonDirectionalTranslucencyLightingMode)) || bHasRefraction;
 		break;
-	case MP_SubsurfaceColor:
-		Active = ShadingModels.HasAnyShadingModel({ MSM_Subsurface, MSM_PreintegratedSkin, MSM_TwoSidedFoliage, MSM_Cloth });
-		break;
-	case MP_CustomData0:
-		Active = ShadingModels.HasAnyShadingModel({ MSM_ClearCoat, MSM_Hair, MSM_Cloth, MSM_Eye, MSM_Toon, MSM_ToonSkin, MSM_ToonHair, MSM_ToonAniso, MSM_Anisotropic });
-		break;
-	case MP_CustomData1:
-		Active = ShadingModels.HasAnyShadingModel({ MSM_ClearCoat, MSM_Eye,  MSM_Toon, MSM_ToonSkin, MSM_ToonHair, MSM_ToonAniso, MSM_Anisotropic });
-		break;
 	case MP_TessellationMultiplier:
 	case MP_WorldDisplacement:
 		Active = bHasTessellation;
@@ -5964,15 +6042,6 @@ static bool IsPropertyActive_Internal(EMaterialProperty InProperty,
 	case MP_PixelDepthOffset:
 		Active = !bIsTranslucentBlendMode;
 		break;
-	case MP_SpecularOffset:
-		Active = ShadingModels.HasAnyShadingModel({MSM_Toon, MSM_ToonHair, MSM_ToonAniso, MSM_ToonSkin});
-		break;
-	case MP_SpecularRange:
-		Active = ShadingModels.HasAnyShadingModel({MSM_Toon, MSM_ToonSkin});
-		break;
-	case MP_ShadowColor:
-		Active = ShadingModels.HasAnyShadingModel({MSM_ToonSkin, MSM_ToonAniso, MSM_Anisotropic});
-		break;
 	case MP_ShadingModel:
 		Active = bUsesShadingModelFromMaterialExpression;
                 break;
@@ -0,0 +1,111 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialPropertyShadingModels.h: Which shading models read each material property.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SceneTypes.h"
+#include "Engine/EngineTypes.h"
+
+namespace MaterialPropertyShadingModels
+{
+	constexpr uint32 ShadingModelBit(EMaterialShadingModel ShadingModel)
+	{
+		return 1u << (uint32)ShadingModel;
+	}
+
+	constexpr uint32 AllShadingModels = (uint32)((1ull << MSM_NUM) - 1);
+	constexpr uint32 ToonShadingModels = ShadingModelBit(MSM_Toon) | ShadingModelBit(MSM_ToonSkin) | ShadingModelBit(MSM_ToonHair) | ShadingModelBit(MSM_ToonAniso);
+
+	/**
+	 * Shading models reading InProperty, in the layout of FMaterialShadingModelField.
+	 * Properties whose activity does not depend on a list of shading models get AllShadingModels, including the ones only
+	 * needing FMaterialShadingModelField::IsLit(). The other conditions of IsPropertyActive_Internal in Material.cpp
+	 * (domain, blend mode...) still apply on top of it.
+	 */
+	constexpr uint32 GetShadingModelMask(EMaterialProperty InProperty)
+	{
+		switch (InProperty)
+		{
+		case MP_SubsurfaceColor:
+			return ShadingModelBit(MSM_Subsurface) | ShadingModelBit(MSM_PreintegratedSkin) | ShadingModelBit(MSM_TwoSidedFoliage) | ShadingModelBit(MSM_Cloth);
+		case MP_CustomData0:
+			return ShadingModelBit(MSM_ClearCoat) | ShadingModelBit(MSM_Hair) | ShadingModelBit(MSM_Cloth) | ShadingModelBit(MSM_Eye) | ToonShadingModels | ShadingModelBit(MSM_Anisotropic);
+		case MP_CustomData1:
+			return ShadingModelBit(MSM_ClearCoat) | ShadingModelBit(MSM_Eye) | ToonShadingModels | ShadingModelBit(MSM_Anisotropic);
+		// Stylized Shading, see ShadingModelsMaterial.ush
+		case MP_SpecularOffset:
+			return ToonShadingModels;
+		case MP_SpecularRange:
+			return ShadingModelBit(MSM_Toon) | ShadingModelBit(MSM_ToonSkin);
+		case MP_ShadowColor:
+			return ShadingModelBit(MSM_ToonSkin) | ShadingModelBit(MSM_ToonAniso) | ShadingModelBit(MSM_Anisotropic);
+		default:
+			return AllShadingModels;
+		}
+	}
+
+	/** GetShadingModelMask of every property, so a query is a load and an AND. */
+	struct FShadingModelMaskTable
+	{
+		uint32 Masks[MP_MAX + 1];
+
+		constexpr FShadingModelMaskTable()
+			: Masks()
+		{
+			for (int32 Property = 0; Property <= MP_MAX; ++Property)
+			{
+				Masks[Property] = GetShadingModelMask((EMaterialProperty)Property);
+			}
+		}
+	};
+
+	constexpr FShadingModelMaskTable ShadingModelMaskTable;
+
+	/** CustomData (GBufferD) channels, in the layout of MATERIAL_CUSTOMDATA_USED_MASK in BasePassCommon.ush. */
+	constexpr uint32 CustomDataX = 1u << 0;
+	constexpr uint32 CustomDataY = 1u << 1;
+	constexpr uint32 CustomDataZ = 1u << 2;
+	constexpr uint32 CustomDataW = 1u << 3;
+	constexpr uint32 AllCustomData = CustomDataX | CustomDataY | CustomDataZ | CustomDataW;
+
+	/**
+	 * CustomData channels the lighting passes read back for InShadingModel, see ShadingModelsMaterial.ush and ShadingModels.ush.
+	 * Only the toon and Anisotropic models are narrowed down, the other ones writing CustomData keep all channels.
+	 * Material dependent narrowing (toon parameter table, isotropic ToonAniso) is done by the translator.
+	 */
+	constexpr uint32 GetCustomDataChannelMask(EMaterialShadingModel InShadingModel)
+	{
+		switch (InShadingModel)
+		{
+		case MSM_Unlit:
+		case MSM_DefaultLit:
+			return 0;
+		// Shadow intensity, specular offset, specular range, terminator offset
+		case MSM_Toon:
+		// Shadow color, terminator offset and SSS mode
+		case MSM_ToonSkin:
+		// Tangent, anisotropic roughness, anisotropy
+		case MSM_ToonAniso:
+			return AllCustomData;
+		// Scatter, specular tightness and terminator offset. ToonHairBxDF decodes the tangent in X but never reads it
+		case MSM_ToonHair:
+			return CustomDataY | CustomDataZ | CustomDataW;
+		// Tangent and anisotropy, the roughness comes from GBufferB
+		case MSM_Anisotropic:
+			return CustomDataX | CustomDataY | CustomDataW;
+		default:
+			return AllCustomData;
+		}
+	}
+
+	/** Whether any of ShadingModels reads InProperty. */
+	FORCEINLINE bool IsReadByShadingModels(EMaterialProperty InProperty, const FMaterialShadingModelField& ShadingModels)
+	{
+		checkSlow(InProperty <= MP_MAX);
+		return (ShadingModelMaskTable.Masks[InProperty] & ShadingModels.GetShadingModelField()) != 0;
+	}
+}
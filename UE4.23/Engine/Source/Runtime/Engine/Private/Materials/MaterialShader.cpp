@@ -15,6 +15,12 @@
 #include "ProfilingDebugging/CookStats.h"
 #include "UObject/ReleaseObjectVersion.h"
 #include "UObject/EditorObjectVersion.h"
+#include "ToonMaterialParameterTable.h"
+#include "MaterialShaderMapPrefetch.h"
+#include "MaterialShaderCompileStats.h"
+#include "Engine/ToonShaderPermutationSettings.h"
+#include "Materials/MaterialShaderBytecodeStore.h"
+#include "Materials/MaterialShaderDDCCompression.h"
 
 #if ENABLE_COOK_STATS
 namespace MaterialShaderCookStats
@@ -42,6 +48,13 @@ TArray<FMaterialShaderMap*> FMaterialShaderMap::AllMaterialShaderMaps;
 #endif
 // The Id of 0 is reserved for global shaders
 uint32 FMaterialShaderMap::NextCompilingId = 2;
+#if WITH_EDITOR
+/**
+ * Shading models of the material each compiling id was assigned for, to attribute the finished jobs in FMaterialShaderCompileStats.
+ * Removed when the shader map is finalized, or destroyed without having been.
+ */
+static TMap<uint32, FMaterialShadingModelField> GCompilingIdToShadingModels;
+#endif
 /** 
  * Tracks material resources and their shader maps that are being compiled.
  * Uses a TRefCountPtr as this will be the only reference to a shader map while it is being compiled.
@@ -135,6 +148,13 @@ static FString GetMaterialShaderMapKeyString(const FMaterialShaderMapId& ShaderM
 	ShaderMapAppendKeyString(Platform, ShaderMapKeyString);
 	ShaderMapId.AppendKeyString(ShaderMapKeyString);
 	FMaterialAttributeDefinitionMap::AppendDDCKeyString(ShaderMapKeyString);
+	if (IsToonMaterialParameterTableEnabled())
+	{
+		ShaderMapKeyString += TEXT("_TOONTABLE");
+	}
+	AppendToonShaderPruningKeyString(ShaderMapKeyString);
+	MaterialShaderBytecodeStore::AppendKeyString(ShaderMapKeyString);
+	MaterialShaderDDCCompression::AppendKeyString(ShaderMapKeyString);
 	return FDerivedDataCacheInterface::BuildCacheKey(TEXT("MATSM"), MATERIALSHADERMAP_DERIVEDDATA_VER, *ShaderMapKeyString);
 }
 #endif // WITH_EDITOR
@@ -1155,17 +1175,32 @@ void FMaterialShaderMap::LoadFromDerivedDataCache(const FMaterial* Material, con
 			TArray<uint8> CachedData;
 			const FString DataKey = GetMaterialShaderMapKeyString(ShaderMapId, InPlatform);
 
-			if (GetDerivedDataCacheRef().GetSynchronous(*DataKey, CachedData))
+			bool bFound = false;
+			if (!FMaterialShaderMapPrefetcher::Get().Take(DataKey, bFound, CachedData))
+			{
+				bFound = GetDerivedDataCacheRef().GetSynchronous(*DataKey, CachedData);
+			}
+
+			// Decompresses the payload a chunk at a time as it is deserialized
+			TUniquePtr<FArchive> Ar = bFound ? MaterialShaderDDCCompression::CreateReader(CachedData) : nullptr;
+
+			// Keeps the shared shader resources alive until the shaders referencing them are registered
+			TArray<TRefCountPtr<FShaderResource>> SharedResources;
+			const bool bSharedBytecode = MaterialShaderBytecodeStore::IsEnabled();
+			if (bFound && bSharedBytecode)
+			{
+				bFound = MaterialShaderBytecodeStore::LoadResources(*Ar, SharedResources);
+			}
+
+			if (bFound)
 			{
 				COOK_STAT(Timer.AddHit(CachedData.Num()));
 				InOutShaderMap = new FMaterialShaderMap(InPlatform);
-				FMemoryReader Ar(CachedData, true);
 
 				// Deserialize from the cached data
-				InOutShaderMap->Serialize(Ar);
+				InOutShaderMap->Serialize(*Ar, !bSharedBytecode);
 				InOutShaderMap->RegisterSerializedShaders(false);
 
-				const FString InDataKey = GetMaterialShaderMapKeyString(InOutShaderMap->GetShaderMapId(), InPlatform);
 				checkSlow(InOutShaderMap->GetShaderMapId() == ShaderMapId);
 
 				// Register in the global map
@@ -1182,12 +1217,112 @@ void FMaterialShaderMap::LoadFromDerivedDataCache(const FMaterial* Material, con
 	}
 }
 
+FMaterialShaderMapPrefetcher& FMaterialShaderMapPrefetcher::Get()
+{
+	static FMaterialShaderMapPrefetcher Prefetcher;
+	return Prefetcher;
+}
+
+void FMaterialShaderMapPrefetcher::Prefetch(const FMaterial& Material, EShaderPlatform Platform)
+{
+	bool bInScope;
+	{
+		FScopeLock Lock(&CriticalSection);
+		bInScope = ScopeDepth > 0;
+	}
+
+	// Same conditions as FMaterial::CacheShaders for going to the DDC
+	if (!bInScope || FPlatformProperties::RequiresCookedData() || Material.GetMaterialShaderMapUsage() == EMaterialShaderMapUsage::DebugViewMode)
+	{
+		return;
+	}
+
+	FMaterialShaderMapId ShaderMapId;
+	Material.GetShaderMapId(Platform, ShaderMapId);
+
+	TRefCountPtr<FMaterialShaderMap> ShaderMap = FMaterialShaderMap::FindId(ShaderMapId, Platform);
+	if (!ShaderMap || !ShaderMap->IsComplete(&Material, true))
+	{
+		Prefetch(ShaderMapId, Platform);
+	}
+}
+
+void FMaterialShaderMapPrefetcher::Prefetch(const FMaterialShaderMapId& ShaderMapId, EShaderPlatform Platform)
+{
+	FString DataKey = GetMaterialShaderMapKeyString(ShaderMapId, Platform);
+
+	FScopeLock Lock(&CriticalSection);
+	if (ScopeDepth > 0 && !PendingRequests.Contains(DataKey))
+	{
+		const uint32 Handle = GetDerivedDataCacheRef().GetAsynchronous(*DataKey);
+		PendingRequests.Add(MoveTemp(DataKey), Handle);
+	}
+}
+
+bool FMaterialShaderMapPrefetcher::Take(const FString& DataKey, bool& bOutFound, TArray<uint8>& OutData)
+{
+	uint32 Handle;
+	{
+		FScopeLock Lock(&CriticalSection);
+		if (!PendingRequests.RemoveAndCopyValue(DataKey, Handle))
+		{
+			return false;
+		}
+	}
+
+	GetDerivedDataCacheRef().WaitAsynchronousCompletion(Handle);
+	bOutFound = GetDerivedDataCacheRef().GetAsynchronousResults(Handle, OutData);
+	return true;
+}
+
+void FMaterialShaderMapPrefetcher::BeginScope()
+{
+	FScopeLock Lock(&CriticalSection);
+	++ScopeDepth;
+}
+
+void FMaterialShaderMapPrefetcher::EndScope()
+{
+	TMap<FString, uint32> UnclaimedRequests;
+	{
+		FScopeLock Lock(&CriticalSection);
+		check(ScopeDepth > 0);
+		if (--ScopeDepth > 0)
+		{
+			return;
+		}
+		UnclaimedRequests = MoveTemp(PendingRequests);
+		PendingRequests.Reset();
+	}
+
+	// A shader map id changed between Prefetch and CacheShaders, or the shaders were not cached after all.
+	// Every asynchronous request has to be collected for the DDC to free it.
+	for (const TPair<FString, uint32>& Request : UnclaimedRequests)
+	{
+		TArray<uint8> UnusedData;
+		GetDerivedDataCacheRef().WaitAsynchronousCompletion(Request.Value);
+		GetDerivedDataCacheRef().GetAsynchronousResults(Request.Value, UnusedData);
+	}
+}
+
 void FMaterialShaderMap::SaveToDerivedDataCache()
 {
 	COOK_STAT(auto Timer = MaterialShaderCookStats::UsageStats.TimeSyncWork());
+	// Serialize seeks back to patch offsets, so the payload is only compressed once complete
+	TArray<uint8> RawData;
+	FMemoryWriter Ar(RawData, true);
+	if (MaterialShaderBytecodeStore::IsEnabled())
+	{
+		MaterialShaderBytecodeStore::SaveResources(Ar, *this);
+		Serialize(Ar, false);
+	}
+	else
+	{
+		Serialize(Ar);
+	}
+
 	TArray<uint8> SaveData;
-	FMemoryWriter Ar(SaveData, true);
-	Serialize(Ar);
+	MaterialShaderDDCCompression::CompressPayload(RawData, SaveData);
 
 	GetDerivedDataCacheRef().Put(*GetMaterialShaderMapKeyString(ShaderMapId, GetShaderPlatform()), SaveData);
 	COOK_STAT(Timer.AddMiss(SaveData.Num()));
@@ -1473,6 +1608,9 @@ void FMaterialShaderMap::Compile(
 			CompilingId = NextCompilingId;
 			check(NextCompilingId < UINT_MAX);
 			NextCompilingId++;
+#if WITH_EDITOR
+			GCompilingIdToShadingModels.Add(CompilingId, Material->GetShadingModels());
+#endif
   
 			TArray<FMaterial*> NewCorrespondingMaterials;
 			NewCorrespondingMaterials.Add(Material);
@@ -1797,6 +1935,11 @@ FShader* FMaterialShaderMap::ProcessCompilationResultsForSingleJob(FShaderCompil
 #if WITH_EDITOR
 	// add shader source to 
 	ShaderProcessedSource.Add(CurrentJob.ShaderType->GetFName(), CurrentJob.Output.OptionalFinalShaderSource);
+
+	if (const FMaterialShadingModelField* ShadingModels = GCompilingIdToShadingModels.Find(CompilingId))
+	{
+		FMaterialShaderCompileStats::Get().AddJob(*ShadingModels, CurrentJob.Output.CompileTime, CurrentJob.Output.ShaderCode.GetReadAccess().Num(), CurrentJob.Output.NumInstructions);
+	}
 #endif
 
 	return Shader;
@@ -1963,6 +2106,8 @@ bool FMaterialShaderMap::ProcessCompilationResults(const TArray<FShaderCommonCom
 			SaveToDerivedDataCache();
 		}
 
+		GCompilingIdToShadingModels.Remove(CompilingId);
+
 		// The shader map can now be used on the rendering thread
 		bCompilationFinalized = true;
 
@@ -2349,6 +2494,10 @@ FMaterialShaderMap::~FMaterialShaderMap()
 #if ALLOW_SHADERMAP_DEBUG_DATA
 	AllMaterialShaderMaps.RemoveSwap(this);
 #endif
+#if WITH_EDITOR
+	// Compiles that never reach ProcessCompilationResults, cancelled or failed ones, release their only reference from ShaderMapsBeingCompiled
+	GCompilingIdToShadingModels.Remove(CompilingId);
+#endif
 }
 
 /**
@@ -0,0 +1,248 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialShaderBytecodeStore.cpp: Content addressed DDC store of material shader bytecode.
+=============================================================================*/
+
+#include "Materials/MaterialShaderBytecodeStore.h"
+
+#if WITH_EDITOR
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryWriter.h"
+#include "DerivedDataCacheInterface.h"
+#include "ShaderDerivedDataVersion.h"
+#include "ProfilingDebugging/CookStats.h"
+#include "Materials/MaterialShaderDDCCompression.h"
+
+// Change this guid to invalidate the stored shader resources, e.g. after a change to FShaderResource::Serialize
+#define MATERIALSHADERBYTECODE_DERIVEDDATA_VER TEXT("3C0F7E2A9D4B4E61B5A8D17F0C6E92B4")
+
+static TAutoConsoleVariable<int32> CVarSharedBytecode(
+	TEXT("r.MaterialShaderMap.SharedBytecode"),
+	1,
+	TEXT("Stores the shader resources of the material shader maps once per compiled output in the derived data cache,\n")
+	TEXT("instead of inlining them in every shader map entry.\n")
+	TEXT(" 0: inline the resources\n")
+	TEXT(" 1: share identical resources between shader maps (default)"),
+	ECVF_ReadOnly);
+
+namespace MaterialShaderBytecodeStore
+{
+	/** Keys put in the DDC during this session, with the size of their resource. */
+	static TMap<FString, int32> GStoredResourceSizes;
+	static FCriticalSection GStoreCS;
+
+	// All byte counts are uncompressed resource sizes (FShaderResource::GetSizeBytes), whatever the DDC compression setting
+
+	/** Resource bytes the saved shader maps reference, what inlining them would have stored. */
+	static int64 GReferencedBytes = 0;
+	/** Resource bytes put in the DDC, once per resource and session. */
+	static int64 GStoredBytes = 0;
+	/** Resource bytes loaded shader maps reference. */
+	static int64 GLoadReferencedBytes = 0;
+	/** Resource bytes fetched from the DDC, the others were already in memory. */
+	static int64 GFetchedBytes = 0;
+	static int32 GNumStoredResources = 0;
+	static int32 GNumFetchedResources = 0;
+	static int32 GNumResourcesInMemory = 0;
+
+#if ENABLE_COOK_STATS
+	static FCookStatsManager::FAutoRegisterCallback RegisterCookStats([](FCookStatsManager::AddStatFuncRef AddStat)
+	{
+		AddStat(TEXT("MaterialShader.SharedBytecode"), FCookStatsManager::CreateKeyValueArray(
+			TEXT("ReferencedBytes"), GReferencedBytes,
+			TEXT("StoredBytes"), GStoredBytes,
+			TEXT("StoredResources"), GNumStoredResources,
+			TEXT("LoadReferencedBytes"), GLoadReferencedBytes,
+			TEXT("FetchedBytes"), GFetchedBytes,
+			TEXT("FetchedResources"), GNumFetchedResources,
+			TEXT("ResourcesInMemory"), GNumResourcesInMemory
+			));
+	});
+#endif
+
+	static FString GetResourceKey(const FShaderResourceId& ResourceId)
+	{
+		// The serialized id holds the shader target, the output hash and the specific type, all the resource is looked up by in memory
+		TArray<uint8> IdData;
+		FMemoryWriter IdAr(IdData, true);
+		IdAr << const_cast<FShaderResourceId&>(ResourceId);
+
+		FSHAHash IdHash;
+		FSHA1::HashBuffer(IdData.GetData(), IdData.Num(), IdHash.Hash);
+
+		FString KeySuffix = IdHash.ToString() + TEXT("_") + MATERIALSHADERMAP_DERIVEDDATA_VER;
+		MaterialShaderDDCCompression::AppendKeyString(KeySuffix);
+		return FDerivedDataCacheInterface::BuildCacheKey(TEXT("MATSHADERCODE"), MATERIALSHADERBYTECODE_DERIVEDDATA_VER, *KeySuffix);
+	}
+
+	bool IsEnabled()
+	{
+		return CVarSharedBytecode.GetValueOnAnyThread() != 0;
+	}
+
+	void AppendKeyString(FString& KeyString)
+	{
+		if (IsEnabled())
+		{
+			KeyString += TEXT("_SHAREDCODE");
+		}
+	}
+
+	void SaveResources(FArchive& Ar, const FMaterialShaderMap& ShaderMap)
+	{
+		TMap<FShaderId, FShader*> Shaders;
+		ShaderMap.GetShaderList(Shaders);
+
+		TArray<FShaderPipeline*> ShaderPipelines;
+		ShaderMap.GetShaderPipelineList(ShaderPipelines);
+		for (FShaderPipeline* ShaderPipeline : ShaderPipelines)
+		{
+			for (FShader* Shader : ShaderPipeline->GetShaders())
+			{
+				Shaders.Add(Shader->GetId(), Shader);
+			}
+		}
+
+		TArray<FShaderResourceId> ResourceIds;
+		for (const TPair<FShaderId, FShader*>& Pair : Shaders)
+		{
+			ResourceIds.AddUnique(Pair.Value->GetResourceId());
+		}
+
+		int32 NumResources = ResourceIds.Num();
+		Ar << NumResources;
+
+		for (FShaderResourceId& ResourceId : ResourceIds)
+		{
+			Ar << ResourceId;
+
+			const FString Key = GetResourceKey(ResourceId);
+			int32 ResourceSize = 0;
+			bool bStored = false;
+			{
+				FScopeLock Lock(&GStoreCS);
+				if (const int32* StoredSize = GStoredResourceSizes.Find(Key))
+				{
+					ResourceSize = *StoredSize;
+					bStored = true;
+				}
+			}
+
+			if (!bStored)
+			{
+				FShaderResource* Resource = FShaderResource::FindShaderResourceById(ResourceId);
+				check(Resource);
+				ResourceSize = Resource->GetSizeBytes();
+
+				TArray<uint8> RawResourceData;
+				FMemoryWriter ResourceAr(RawResourceData, true);
+				Resource->Serialize(ResourceAr, false);
+
+				TArray<uint8> ResourceData;
+				MaterialShaderDDCCompression::CompressPayload(RawResourceData, ResourceData);
+
+				// Not probed first: the key only depends on the resource, so putting it again is harmless, and the backends
+				// skip keys they already hold on the DDC thread instead of stalling the save on a shared DDC round trip
+				GetDerivedDataCacheRef().Put(*Key, ResourceData);
+
+				FScopeLock Lock(&GStoreCS);
+				GStoredResourceSizes.Add(Key, ResourceSize);
+				GStoredBytes += ResourceSize;
+				GNumStoredResources++;
+			}
+
+			FScopeLock Lock(&GStoreCS);
+			GReferencedBytes += ResourceSize;
+		}
+	}
+
+	bool LoadResources(FArchive& Ar, TArray<TRefCountPtr<FShaderResource>>& OutResources)
+	{
+		int32 NumResources = 0;
+		Ar << NumResources;
+
+		struct FPendingResource
+		{
+			FString Key;
+			uint32 Handle;
+		};
+		TArray<FPendingResource> PendingResources;
+
+		for (int32 Index = 0; Index < NumResources && !Ar.IsError(); ++Index)
+		{
+			FShaderResourceId ResourceId;
+			Ar << ResourceId;
+
+			if (FShaderResource* ExistingResource = FShaderResource::FindShaderResourceById(ResourceId))
+			{
+				OutResources.Add(ExistingResource);
+
+				FScopeLock Lock(&GStoreCS);
+				GLoadReferencedBytes += ExistingResource->GetSizeBytes();
+				GNumResourcesInMemory++;
+			}
+			else
+			{
+				FPendingResource& PendingResource = PendingResources.AddDefaulted_GetRef();
+				PendingResource.Key = GetResourceKey(ResourceId);
+				PendingResource.Handle = GetDerivedDataCacheRef().GetAsynchronous(*PendingResource.Key);
+			}
+		}
+
+		// Every request is collected, even after a miss, for the DDC to free it
+		bool bAllFound = !Ar.IsError();
+		for (const FPendingResource& PendingResource : PendingResources)
+		{
+			TArray<uint8> ResourceData;
+			GetDerivedDataCacheRef().WaitAsynchronousCompletion(PendingResource.Handle);
+			if (!GetDerivedDataCacheRef().GetAsynchronousResults(PendingResource.Handle, ResourceData))
+			{
+				UE_LOG(LogMaterial, Verbose, TEXT("Shared shader resource %s is missing from the DDC"), *PendingResource.Key);
+				bAllFound = false;
+			}
+			if (!bAllFound)
+			{
+				continue;
+			}
+
+			FShaderResource* Resource = new FShaderResource();
+			TUniquePtr<FArchive> ResourceAr = MaterialShaderDDCCompression::CreateReader(ResourceData);
+			Resource->Serialize(*ResourceAr, false);
+
+			// Same as LoadForRemoteRecompile: a resource registered in the meantime is shared instead
+			if (FShaderResource* ExistingResource = FShaderResource::FindShaderResourceById(Resource->GetId()))
+			{
+				delete Resource;
+				OutResources.Add(ExistingResource);
+			}
+			else
+			{
+				Resource->Register();
+				OutResources.Add(Resource);
+			}
+
+			const int32 ResourceSize = OutResources.Last()->GetSizeBytes();
+			FScopeLock Lock(&GStoreCS);
+			GLoadReferencedBytes += ResourceSize;
+			GFetchedBytes += ResourceSize;
+			GNumFetchedResources++;
+		}
+
+		return bAllFound;
+	}
+
+	void LogStats()
+	{
+		FScopeLock Lock(&GStoreCS);
+		UE_LOG(LogMaterial, Display, TEXT("Shared material shader bytecode: saved shader maps reference %.2f MB, %.2f MB in %d resources put in the DDC (%.2f MB saved, uncompressed sizes)"),
+			GReferencedBytes / (1024.0 * 1024.0), GStoredBytes / (1024.0 * 1024.0), GNumStoredResources, (GReferencedBytes - GStoredBytes) / (1024.0 * 1024.0));
+		UE_LOG(LogMaterial, Display, TEXT("Shared material shader bytecode: loaded shader maps reference %.2f MB, %.2f MB in %d resources fetched, %d resources already in memory (%.2f MB not loaded again, uncompressed sizes)"),
+			GLoadReferencedBytes / (1024.0 * 1024.0), GFetchedBytes / (1024.0 * 1024.0), GNumFetchedResources, GNumResourcesInMemory, (GLoadReferencedBytes - GFetchedBytes) / (1024.0 * 1024.0));
+	}
+}
+
+#endif // WITH_EDITOR
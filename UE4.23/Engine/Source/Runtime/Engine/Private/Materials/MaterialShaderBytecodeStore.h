@@ -0,0 +1,46 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialShaderBytecodeStore.h: Content addressed DDC store of material shader bytecode.
+
+	Material shader maps inline every shader resource in their DDC entry, so materials whose shaders
+	compile to the same bytecode (e.g. instances whose static parameters only differ on an inactive pin)
+	each store and load their own copy. With r.MaterialShaderMap.SharedBytecode the entry only lists the
+	FShaderResourceIds of its shaders, and each resource is stored once in the DDC under a key derived from
+	its id, which contains the hash of the compiled output. Loading skips the resources already in memory.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MaterialShared.h"
+#include "Shader.h"
+
+#if WITH_EDITOR
+
+namespace MaterialShaderBytecodeStore
+{
+	/** Whether r.MaterialShaderMap.SharedBytecode is set. */
+	bool IsEnabled();
+
+	/** Appended to the shader map DDC keys, whose entries have a different layout with the store. */
+	void AppendKeyString(FString& KeyString);
+
+	/**
+	 * Writes the resource ids of the shaders of ShaderMap and puts the resources not put yet in this session, without probing the DDC.
+	 * The shader map must then be serialized without inlining its resources.
+	 */
+	void SaveResources(FArchive& Ar, const FMaterialShaderMap& ShaderMap);
+
+	/**
+	 * Reads the ids written by SaveResources and registers their resources, fetching the ones not in memory from the DDC in parallel.
+	 * @param OutResources	Keeps the resources alive until the shaders referencing them are serialized and registered
+	 * @return false if a resource is not in the DDC anymore, the shader map has to be compiled again
+	 */
+	bool LoadResources(FArchive& Ar, TArray<TRefCountPtr<FShaderResource>>& OutResources);
+
+	/** Logs the bytes the store saved in the DDC and in load time allocations so far. */
+	void LogStats();
+}
+
+#endif // WITH_EDITOR
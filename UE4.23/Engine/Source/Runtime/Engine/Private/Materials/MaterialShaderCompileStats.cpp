@@ -0,0 +1,76 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialShaderCompileStats.cpp: Material shader compile cost per shading model.
+=============================================================================*/
+
+#include "MaterialShaderCompileStats.h"
+
+#if WITH_EDITOR
+
+#include "Misc/ScopeLock.h"
+#include "UObject/Class.h"
+
+FMaterialShaderCompileStats& FMaterialShaderCompileStats::Get()
+{
+	static FMaterialShaderCompileStats CompileStats;
+	return CompileStats;
+}
+
+void FMaterialShaderCompileStats::AddJob(FMaterialShadingModelField ShadingModels, double CompileSeconds, uint32 BytecodeBytes, uint32 NumInstructions)
+{
+	FScopeLock Lock(&CriticalSection);
+	for (int32 ShadingModel = 0; ShadingModel < MSM_NUM; ++ShadingModel)
+	{
+		if (ShadingModels.HasShadingModel((EMaterialShadingModel)ShadingModel))
+		{
+			FShadingModelCompileStats& ModelStats = Stats[ShadingModel];
+			ModelStats.NumJobs++;
+			ModelStats.CompileSeconds += CompileSeconds;
+			ModelStats.BytecodeBytes += BytecodeBytes;
+			ModelStats.NumInstructions += NumInstructions;
+		}
+	}
+}
+
+FShadingModelCompileStats FMaterialShaderCompileStats::GetStats(EMaterialShadingModel ShadingModel) const
+{
+	check(ShadingModel < MSM_NUM);
+	FScopeLock Lock(&CriticalSection);
+	return Stats[ShadingModel];
+}
+
+void FMaterialShaderCompileStats::Reset()
+{
+	FScopeLock Lock(&CriticalSection);
+	for (FShadingModelCompileStats& ModelStats : Stats)
+	{
+		ModelStats = FShadingModelCompileStats();
+	}
+}
+
+FString FMaterialShaderCompileStats::ToCSV() const
+{
+	FString CSV = TEXT("ShadingModel,Jobs,CompileSeconds,BytecodeBytes,Instructions,AverageInstructions") LINE_TERMINATOR;
+
+	FScopeLock Lock(&CriticalSection);
+	for (int32 ShadingModel = 0; ShadingModel < MSM_NUM; ++ShadingModel)
+	{
+		const FShadingModelCompileStats& ModelStats = Stats[ShadingModel];
+		if (ModelStats.NumJobs == 0)
+		{
+			continue;
+		}
+
+		CSV += FString::Printf(TEXT("%s,%u,%.3f,%llu,%llu,%.1f") LINE_TERMINATOR,
+			*StaticEnum<EMaterialShadingModel>()->GetNameStringByValue(ShadingModel),
+			ModelStats.NumJobs,
+			ModelStats.CompileSeconds,
+			ModelStats.BytecodeBytes,
+			ModelStats.NumInstructions,
+			(double)ModelStats.NumInstructions / ModelStats.NumJobs);
+	}
+	return CSV;
+}
+
+#endif // WITH_EDITOR
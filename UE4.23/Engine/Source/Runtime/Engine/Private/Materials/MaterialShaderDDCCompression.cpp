@@ -0,0 +1,92 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialShaderDDCCompression.cpp: Compressed DDC payloads of the material shader maps.
+=============================================================================*/
+
+#include "Materials/MaterialShaderDDCCompression.h"
+
+#if WITH_EDITOR
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/ArchiveSaveCompressedProxy.h"
+#include "Serialization/ArchiveLoadCompressedProxy.h"
+
+static TAutoConsoleVariable<int32> CVarDDCCompression(
+	TEXT("r.MaterialShaderMap.DDCCompression"),
+	1,
+	TEXT("Compresses the material shader map payloads stored in the derived data cache, in chunks decompressed while the shader map loads.\n")
+	TEXT(" 0: uncompressed\n")
+	TEXT(" 1: zlib (default)"),
+	ECVF_ReadOnly);
+
+namespace MaterialShaderDDCCompression
+{
+	FName GetFormat()
+	{
+		return CVarDDCCompression.GetValueOnAnyThread() != 0 ? NAME_Zlib : NAME_None;
+	}
+
+	void AppendKeyString(FString& KeyString)
+	{
+		const FName Format = GetFormat();
+		if (Format != NAME_None)
+		{
+			KeyString += TEXT("_") + Format.ToString();
+		}
+	}
+
+	static FPayloadStats GPayloadStats;
+	static FCriticalSection GPayloadStatsCS;
+
+	void CompressPayload(TArray<uint8>& RawData, TArray<uint8>& OutData, FName Format, bool bFreeRawData)
+	{
+		const int64 RawBytes = RawData.Num();
+		if (Format == NAME_None)
+		{
+			if (bFreeRawData)
+			{
+				OutData = MoveTemp(RawData);
+			}
+			else
+			{
+				OutData = RawData;
+			}
+		}
+		else
+		{
+			// Only writes forward, the proxy splits the buffer into chunks and flushes the last one when destroyed
+			FArchiveSaveCompressedProxy CompressedAr(OutData, Format);
+			CompressedAr.Serialize(RawData.GetData(), RawData.Num());
+		}
+
+		if (bFreeRawData)
+		{
+			RawData.Empty();
+		}
+
+		FScopeLock Lock(&GPayloadStatsCS);
+		GPayloadStats.NumPayloads++;
+		GPayloadStats.RawBytes += RawBytes;
+		GPayloadStats.PayloadBytes += OutData.Num();
+	}
+
+	TUniquePtr<FArchive> CreateReader(const TArray<uint8>& Data, FName Format)
+	{
+		if (Format == NAME_None)
+		{
+			return MakeUnique<FMemoryReader>(Data, true);
+		}
+		return MakeUnique<FArchiveLoadCompressedProxy>(Data, Format);
+	}
+
+	FPayloadStats GetPayloadStats()
+	{
+		FScopeLock Lock(&GPayloadStatsCS);
+		return GPayloadStats;
+	}
+}
+
+#endif // WITH_EDITOR
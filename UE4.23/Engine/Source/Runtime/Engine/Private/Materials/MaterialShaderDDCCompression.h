@@ -0,0 +1,48 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialShaderDDCCompression.h: Compressed DDC payloads of the material shader maps.
+
+	With r.MaterialShaderMap.DDCCompression the shader map entries, and the shared shader resources of
+	MaterialShaderBytecodeStore, are stored as a sequence of independently compressed chunks, the format of
+	FArchiveSaveCompressedProxy. The payload is serialized into memory first, since saving a shader map seeks
+	back to patch offsets and the compressed proxy only writes forward. FArchiveLoadCompressedProxy decompresses
+	one chunk at a time as FMaterialShaderMap::Serialize reads, so loading never holds a second uncompressed
+	copy of the payload.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_EDITOR
+
+namespace MaterialShaderDDCCompression
+{
+	/** Codec selected by r.MaterialShaderMap.DDCCompression, NAME_None when the payloads are stored uncompressed. */
+	FName GetFormat();
+
+	/** Appended to the DDC keys of the payloads, whose layout depends on the codec. */
+	void AppendKeyString(FString& KeyString);
+
+	/** Sizes of the payloads CompressPayload produced during this session. */
+	struct FPayloadStats
+	{
+		int64 NumPayloads = 0;
+		int64 RawBytes = 0;
+		int64 PayloadBytes = 0;
+	};
+
+	/**
+	 * Compresses RawData, a complete serialized payload, into OutData in chunks with Format. OutData is a copy of RawData when Format is NAME_None.
+	 * @param bFreeRawData	Empties RawData as soon as it is compressed
+	 */
+	void CompressPayload(TArray<uint8>& RawData, TArray<uint8>& OutData, FName Format = GetFormat(), bool bFreeRawData = true);
+
+	/** Archive reading a payload written by CompressPayload with the same Format. Data must outlive it. */
+	TUniquePtr<FArchive> CreateReader(const TArray<uint8>& Data, FName Format = GetFormat());
+
+	FPayloadStats GetPayloadStats();
+}
+
+#endif // WITH_EDITOR
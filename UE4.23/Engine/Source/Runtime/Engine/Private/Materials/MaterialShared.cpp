@@ -28,6 +28,7 @@
 #include "MeshMaterialShaderType.h"
 #include "RendererInterface.h"
 #include "Materials/HLSLMaterialTranslator.h"
+#include "Materials/MaterialTranslationCache.h"
 #include "ComponentRecreateRenderStateContext.h"
 #include "EngineModule.h"
 #include "Engine/Texture.h"
@@ -41,6 +42,8 @@
 #include "ProfilingDebugging/LoadTimeTracker.h"
 #include "UObject/CoreRedirects.h"
 #include "RayTracingDefinitions.h"
+#include "ToonMaterialParameterTable.h"
+#include "Engine/ToonShaderPermutationSettings.h"
 
 DEFINE_LOG_CATEGORY(LogMaterial);
 
@@ -1645,6 +1648,7 @@ void FMaterial::SetupMaterialEnvironment(
 	OutEnvironment.SetDefine(TEXT("MATERIAL_ALLOW_NEGATIVE_EMISSIVECOLOR"), AllowNegativeEmissiveColor());
 	OutEnvironment.SetDefine(TEXT("MATERIAL_OUTPUT_OPACITY_AS_ALPHA"), GetBlendableOutputAlpha());
 	OutEnvironment.SetDefine(TEXT("TRANSLUCENT_SHADOW_WITH_MASKED_OPACITY"), GetCastDynamicShadowAsMasked());
+	SetToonMaterialParameterTableDefine(OutEnvironment);
 
 	if (IsUsingFullPrecision())
 	{
@@ -1919,16 +1923,46 @@ bool FMaterial::BeginCompileShaderMap(
 
 	// Generate the material shader code.
 	FMaterialCompilationOutput NewCompilationOutput;
-	FHLSLMaterialTranslator MaterialTranslator(this,NewCompilationOutput,ShaderMapId.GetParameterSet(),Platform,GetQualityLevel(),ShaderMapId.FeatureLevel, TargetPlatform);
-	bSuccess = MaterialTranslator.Translate();
+	// Create a shader compiler environment for the material that will be shared by all jobs from this material
+	TRefCountPtr<FShaderCompilerEnvironment> MaterialEnvironment = new FShaderCompilerEnvironment();
+	FString MaterialShaderCode;
+
+	// Transient materials are not cached for the same reason their shader maps are not, their ids are not unique
+	const bool bUseTranslationCache = IsPersistent() && MaterialTranslationCache::IsEnabled();
+	const FString TranslationKey = bUseTranslationCache ? MaterialTranslationCache::GetKey(ShaderMapId, Platform, TargetPlatform) : FString();
+
+	if (bUseTranslationCache && MaterialTranslationCache::Get(TranslationKey, NewCompilationOutput, *MaterialEnvironment, MaterialShaderCode))
+	{
+		bSuccess = true;
+
+		// What Translate would have done on success
+		CompileErrors.Empty();
+		ErrorExpressions.Empty();
+	}
+	else
+	{
+		// A partial read may have filled some of them
+		NewCompilationOutput = FMaterialCompilationOutput();
+		MaterialEnvironment = new FShaderCompilerEnvironment();
+
+		FHLSLMaterialTranslator MaterialTranslator(this,NewCompilationOutput,ShaderMapId.GetParameterSet(),Platform,GetQualityLevel(),ShaderMapId.FeatureLevel, TargetPlatform);
+		bSuccess = MaterialTranslator.Translate();
+
+		if (bSuccess)
+		{
+			MaterialTranslator.GetMaterialEnvironment(Platform, *MaterialEnvironment);
+			MaterialShaderCode = MaterialTranslator.GetMaterialShaderCode();
+
+			if (bUseTranslationCache)
+			{
+				MaterialTranslationCache::Put(TranslationKey, NewCompilationOutput, *MaterialEnvironment, MaterialShaderCode);
+			}
+		}
+	}
 
 	if(bSuccess)
 	{
-		// Create a shader compiler environment for the material that will be shared by all jobs from this material
-		TRefCountPtr<FShaderCompilerEnvironment> MaterialEnvironment = new FShaderCompilerEnvironment();
 		MaterialEnvironment->TargetPlatform = TargetPlatform;
-		MaterialTranslator.GetMaterialEnvironment(Platform, *MaterialEnvironment);
-		const FString MaterialShaderCode = MaterialTranslator.GetMaterialShaderCode();
 		const bool bSynchronousCompile = RequiresSynchronousCompilation() || !GShaderCompilingManager->AllowAsynchronousShaderCompiling();
 
 		MaterialEnvironment->IncludeVirtualPathToContentsMap.Add(TEXT("/Engine/Generated/Material.ush"), MaterialShaderCode);
@@ -1974,7 +2008,7 @@ bool FMaterial::BeginCompileShaderMap(
  */
 bool FMaterial::ShouldCache(EShaderPlatform Platform, const FShaderType* ShaderType, const FVertexFactoryType* VertexFactoryType) const
 {
-	return true;
+	return FindToonShaderPruningRule(*this, ShaderType, VertexFactoryType) == INDEX_NONE;
 }
 
 //
@@ -2530,6 +2564,7 @@ void FMaterialRenderProxy::ReleaseDynamicRHI()
 	InvalidateUniformExpressionCache(true);
 
 	FExternalTextureRegistry::Get().RemoveMaterialRenderProxyReference(this);
+	GToonMaterialParameterTable.ReleaseSlot(this);
 }
 
 void FMaterialRenderProxy::ReleaseResource()
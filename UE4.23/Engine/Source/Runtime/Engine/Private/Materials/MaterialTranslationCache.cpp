@@ -0,0 +1,96 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialTranslationCache.cpp: Derived data cache of FHLSLMaterialTranslator output.
+=============================================================================*/
+
+#include "Materials/MaterialTranslationCache.h"
+
+#if WITH_EDITOR
+
+#include "HAL/IConsoleManager.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "DerivedDataCacheInterface.h"
+#include "Interfaces/ITargetPlatform.h"
+#include "Interfaces/ITargetPlatformManagerModule.h"
+#include "ShaderCore.h"
+#include "ShaderDerivedDataVersion.h"
+#include "ToonMaterialParameterTable.h"
+
+// Change this guid to invalidate the cached translations without bumping MATERIALSHADERMAP_DERIVEDDATA_VER,
+// e.g. after a change to FHLSLMaterialTranslator that only affects its output.
+#define MATERIALTRANSLATION_DERIVEDDATA_VER TEXT("8E5B1AD3B40C4D6A9F0E6D2C7A41F319")
+
+static TAutoConsoleVariable<int32> CVarMaterialTranslationCache(
+	TEXT("r.MaterialTranslationCache"),
+	1,
+	TEXT("Stores the HLSL translation of persistent materials in the derived data cache, so that compiling their shaders again\n")
+	TEXT("(next cook, editor reload, other quality level of the same graph) skips FHLSLMaterialTranslator.\n")
+	TEXT(" 0: always translate\n")
+	TEXT(" 1: use the cache (default)"),
+	ECVF_Default);
+
+namespace MaterialTranslationCache
+{
+	bool IsEnabled()
+	{
+		return CVarMaterialTranslationCache.GetValueOnAnyThread() != 0;
+	}
+
+	FString GetKey(const FMaterialShaderMapId& ShaderMapId, EShaderPlatform Platform, const ITargetPlatform* TargetPlatform)
+	{
+		const FName Format = LegacyShaderPlatformToShaderFormat(Platform);
+		FString KeyString = Format.ToString() + TEXT("_") + FString::FromInt(GetTargetPlatformManagerRef().ShaderFormatVersion(Format)) + TEXT("_");
+		if (TargetPlatform)
+		{
+			KeyString += TargetPlatform->PlatformName() + TEXT("_");
+		}
+		ShaderMapAppendKeyString(Platform, KeyString);
+
+		FSHAHash MaterialHash;
+		ShaderMapId.GetMaterialHash(MaterialHash);
+		KeyString += TEXT("_") + MaterialHash.ToString();
+		KeyString += TEXT("_") + GetShaderFileHash(TEXT("/Engine/Private/MaterialTemplate.ush"), Platform).ToString();
+
+		FMaterialAttributeDefinitionMap::AppendDDCKeyString(KeyString);
+		if (IsToonMaterialParameterTableEnabled())
+		{
+			KeyString += TEXT("_TOONTABLE");
+		}
+
+		KeyString += TEXT("_");
+		KeyString += MATERIALSHADERMAP_DERIVEDDATA_VER;
+		return FDerivedDataCacheInterface::BuildCacheKey(TEXT("MATTRANS"), MATERIALTRANSLATION_DERIVEDDATA_VER, *KeyString);
+	}
+
+	bool Get(const FString& Key, FMaterialCompilationOutput& OutCompilationOutput, FShaderCompilerEnvironment& OutEnvironment, FString& OutMaterialShaderCode)
+	{
+		TArray<uint8> CachedData;
+		if (!GetDerivedDataCacheRef().GetSynchronous(*Key, CachedData))
+		{
+			return false;
+		}
+
+		FMemoryReader Ar(CachedData, true);
+		OutCompilationOutput.Serialize(Ar);
+		Ar << OutEnvironment;
+		Ar << OutMaterialShaderCode;
+		return !Ar.IsError();
+	}
+
+	void Put(const FString& Key, const FMaterialCompilationOutput& CompilationOutput, const FShaderCompilerEnvironment& Environment, const FString& MaterialShaderCode)
+	{
+		TArray<uint8> SaveData;
+		FMemoryWriter Ar(SaveData, true);
+
+		// Saving leaves them untouched
+		const_cast<FMaterialCompilationOutput&>(CompilationOutput).Serialize(Ar);
+		Ar << const_cast<FShaderCompilerEnvironment&>(Environment);
+		Ar << const_cast<FString&>(MaterialShaderCode);
+
+		GetDerivedDataCacheRef().Put(*Key, SaveData);
+	}
+}
+
+#endif // WITH_EDITOR
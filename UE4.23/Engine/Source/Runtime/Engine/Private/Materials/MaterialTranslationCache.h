@@ -0,0 +1,46 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialTranslationCache.h: Derived data cache of FHLSLMaterialTranslator output.
+
+	FMaterial::BeginCompileShaderMap translates the material graph into HLSL before compiling its shaders.
+	The generated Material.ush, the material shader environment and the FMaterialCompilationOutput only
+	depend on the material graph, its static parameters and property overrides, the platform and the
+	translator itself, so they are stored in the DDC and reused by the next cook or editor session
+	instead of translating again. See r.MaterialTranslationCache.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MaterialShared.h"
+
+#if WITH_EDITOR
+
+class ITargetPlatform;
+
+namespace MaterialTranslationCache
+{
+	/** Whether r.MaterialTranslationCache is set. */
+	bool IsEnabled();
+
+	/**
+	 * DDC key of the translation of a material.
+	 * Hashes the ShaderMapId material fields (graph state, referenced functions and collections, static parameters, property
+	 * overrides, quality and feature level, usage), the platform settings the shader maps are keyed on and MaterialTemplate.ush.
+	 * The shader type dependencies are left out, so editing shaders other than MaterialTemplate.ush does not retranslate.
+	 */
+	FString GetKey(const FMaterialShaderMapId& ShaderMapId, EShaderPlatform Platform, const ITargetPlatform* TargetPlatform);
+
+	/**
+	 * Loads a translation stored by Put.
+	 * @param OutMaterialShaderCode	Contents of /Engine/Generated/Material.ush, not added to OutEnvironment
+	 * @return false if the key is not in the DDC
+	 */
+	bool Get(const FString& Key, FMaterialCompilationOutput& OutCompilationOutput, FShaderCompilerEnvironment& OutEnvironment, FString& OutMaterialShaderCode);
+
+	/** Stores a successful translation. Environment must not hold Material.ush yet, nor anything specific to a shader type. */
+	void Put(const FString& Key, const FMaterialCompilationOutput& CompilationOutput, const FShaderCompilerEnvironment& Environment, const FString& MaterialShaderCode);
+}
+
+#endif // WITH_EDITOR
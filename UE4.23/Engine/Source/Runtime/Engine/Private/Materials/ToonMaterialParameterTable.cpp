@@ -0,0 +1,179 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonMaterialParameterTable.cpp: Per material toon parameters read by the deferred lighting passes.
+=============================================================================*/
+
+#include "ToonMaterialParameterTable.h"
+#include "Materials/ToonMaterialUniformExpressions.h"
+#include "HAL/IConsoleManager.h"
+#include "Stats/Stats.h"
+#include "MaterialShared.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogToonMaterialParameterTable, Log, All);
+
+#if WITH_TOON_MATERIAL_PARAMETER_TABLE
+static TAutoConsoleVariable<int32> CVarToonMaterialParameterTable(
+	TEXT("r.Toon.MaterialParameterTable"),
+	0,
+	TEXT("Toon materials whose toon inputs are all constants or parameters store them in a per material table instead of the GBuffer.\n")
+	TEXT("Only works once the renderer binds View.ToonMaterialParametersTexture and the deferred lighting shaders set TOON_MATERIAL_PARAMETER_TABLE,\n")
+	TEXT("which is why it only exists in builds with WITH_TOON_MATERIAL_PARAMETER_TABLE.\n")
+	TEXT("Changing it recompiles the materials.\n")
+	TEXT(" 0: off (default)\n")
+	TEXT(" 1: on"),
+	ECVF_ReadOnly | ECVF_RenderThreadSafe);
+
+static TAutoConsoleVariable<int32> CVarToonMaterialParameterTableSize(
+	TEXT("r.Toon.MaterialParameterTable.Size"),
+	1024,
+	TEXT("Slots of the toon material parameter table, the number of Toon material render proxies using it at the same time.\n")
+	TEXT("Up to 32768, what CustomData.xy can address. The proxies past it shade with the parameters of slot 0, see stat Shaders."),
+	ECVF_ReadOnly | ECVF_RenderThreadSafe);
+#endif // WITH_TOON_MATERIAL_PARAMETER_TABLE
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Toon Material Slot Overflows"), STAT_ToonMaterialSlotOverflows, STATGROUP_Shaders);
+
+bool IsToonMaterialParameterTableEnabled()
+{
+#if WITH_TOON_MATERIAL_PARAMETER_TABLE
+	return CVarToonMaterialParameterTable.GetValueOnAnyThread() != 0;
+#else
+	return false;
+#endif
+}
+
+void SetToonMaterialParameterTableDefine(FShaderCompilerEnvironment& OutEnvironment)
+{
+	OutEnvironment.SetDefine(TEXT("TOON_MATERIAL_PARAMETER_TABLE"), IsToonMaterialParameterTableEnabled());
+}
+
+TGlobalResource<FToonMaterialParameterTable> GToonMaterialParameterTable;
+
+FToonMaterialParameterTable::FToonMaterialParameterTable()
+	: bEntriesDirty(true)
+	, bLoggedOverflow(false)
+{
+}
+
+void FToonMaterialParameterTable::InitEntries()
+{
+#if WITH_TOON_MATERIAL_PARAMETER_TABLE
+	const int32 NumSlots = FMath::Clamp(CVarToonMaterialParameterTableSize.GetValueOnAnyThread(), 1, ToonShading::MaxToonMaterialSlots);
+#else
+	// Only slot 0, which is all a material evaluated without the table ever asks for
+	const int32 NumSlots = 1;
+#endif
+
+	Entries.Init(FLinearColor::Black, NumSlots);
+	FreeSlots.Reserve(NumSlots);
+	for (int32 Slot = NumSlots - 1; Slot >= 0; --Slot)
+	{
+		FreeSlots.Add(Slot);
+	}
+}
+
+FVector2D FToonMaterialParameterTable::UpdateSlot(const FMaterialRenderProxy* MaterialRenderProxy, const FLinearColor& Inputs)
+{
+	const FLinearColor Entry = ToonShading::MakeToonMaterialParameters(Inputs);
+
+	FScopeLock Lock(&CriticalSection);
+
+	if (Entries.Num() == 0)
+	{
+		InitEntries();
+	}
+
+	int32 Slot = 0;
+	if (const int32* ExistingSlot = Slots.Find(MaterialRenderProxy))
+	{
+		Slot = *ExistingSlot;
+	}
+	else if (FreeSlots.Num() > 0)
+	{
+		Slot = FreeSlots.Pop(false);
+		Slots.Add(MaterialRenderProxy, Slot);
+	}
+	else
+	{
+		// Shares slot 0 with another material rather than writing a slot the texture does not have
+		bool bAlreadyOverflowed = false;
+		OverflowedProxies.Add(MaterialRenderProxy, &bAlreadyOverflowed);
+		if (!bAlreadyOverflowed)
+		{
+			INC_DWORD_STAT(STAT_ToonMaterialSlotOverflows);
+		}
+		if (!bLoggedOverflow)
+		{
+			UE_LOG(LogToonMaterialParameterTable, Warning, TEXT("More than %d Toon material render proxies use the toon material parameter table, the extra ones shade with the parameters of slot 0. Raise r.Toon.MaterialParameterTable.Size."), Entries.Num());
+			bLoggedOverflow = true;
+		}
+		return ToonShading::EncodeToonMaterialSlot(0);
+	}
+
+	if (Entries[Slot] != Entry)
+	{
+		Entries[Slot] = Entry;
+		bEntriesDirty = true;
+	}
+	return ToonShading::EncodeToonMaterialSlot(Slot);
+}
+
+void FToonMaterialParameterTable::ReleaseSlot(const FMaterialRenderProxy* MaterialRenderProxy)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	int32 Slot;
+	if (Slots.RemoveAndCopyValue(MaterialRenderProxy, Slot))
+	{
+		FreeSlots.Add(Slot);
+	}
+	else if (OverflowedProxies.Remove(MaterialRenderProxy) > 0)
+	{
+		DEC_DWORD_STAT(STAT_ToonMaterialSlotOverflows);
+	}
+}
+
+FRHITexture2D* FToonMaterialParameterTable::GetTexture(FRHICommandListImmediate& RHICmdList)
+{
+	check(IsInRenderingThread());
+	FScopeLock Lock(&CriticalSection);
+
+	if (Entries.Num() == 0)
+	{
+		InitEntries();
+	}
+
+	if (!Texture.IsValid())
+	{
+		FRHIResourceCreateInfo CreateInfo;
+		Texture = RHICreateTexture2D(1, Entries.Num(), PF_A32B32G32R32F, 1, 1, TexCreate_ShaderResource, CreateInfo);
+		bEntriesDirty = true;
+	}
+
+	if (bEntriesDirty)
+	{
+		const FUpdateTextureRegion2D Region(0, 0, 0, 0, 1, Entries.Num());
+		RHICmdList.UpdateTexture2D(Texture, 0, Region, sizeof(FLinearColor), (const uint8*)Entries.GetData());
+		bEntriesDirty = false;
+	}
+
+	return Texture;
+}
+
+void FToonMaterialParameterTable::ReleaseDynamicRHI()
+{
+	Texture.SafeRelease();
+}
+
+IMPLEMENT_MATERIALUNIFORMEXPRESSION_TYPE(FMaterialUniformExpressionToonMaterialSlot);
+
+void FMaterialUniformExpressionToonMaterialSlot::GetNumberValue(const FMaterialRenderContext& Context, FLinearColor& OutValue) const
+{
+	FLinearColor Inputs;
+	Input->GetNumberValue(Context, Inputs);
+
+	// Evaluations without a render proxy (e.g. the translator folding constants) must not take a slot
+	const FVector2D EncodedSlot = Context.MaterialRenderProxy ? GToonMaterialParameterTable.UpdateSlot(Context.MaterialRenderProxy, Inputs) : ToonShading::EncodeToonMaterialSlot(0);
+	OutValue = FLinearColor(EncodedSlot.X, EncodedSlot.Y, 0.f, 0.f);
+}
@@ -0,0 +1,53 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonMaterialUniformExpressions.h: Uniform expressions of the toon material parameter table.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Materials/MaterialUniformExpressions.h"
+
+/**
+ * Slot of the material render proxy in GToonMaterialParameterTable, encoded for CustomData.xy.
+ * Evaluating it stores the value of Input (the four Toon inputs) in the proxy's table entry.
+ */
+class FMaterialUniformExpressionToonMaterialSlot : public FMaterialUniformExpression
+{
+	DECLARE_MATERIALUNIFORMEXPRESSION_TYPE(FMaterialUniformExpressionToonMaterialSlot);
+public:
+
+	FMaterialUniformExpressionToonMaterialSlot() {}
+	FMaterialUniformExpressionToonMaterialSlot(FMaterialUniformExpression* InInput) :
+		Input(InInput)
+	{}
+
+	// FMaterialUniformExpression interface.
+	virtual void Serialize(FArchive& Ar)
+	{
+		Ar << Input;
+	}
+	virtual void GetNumberValue(const FMaterialRenderContext& Context, FLinearColor& OutValue) const;
+	/** Never constant, the slot depends on the render proxy even when the inputs do not. */
+	virtual bool IsConstant() const
+	{
+		return false;
+	}
+	virtual bool IsChangingPerFrame() const
+	{
+		return Input->IsChangingPerFrame();
+	}
+	virtual bool IsIdentical(const FMaterialUniformExpression* OtherExpression) const
+	{
+		if (GetType() != OtherExpression->GetType())
+		{
+			return false;
+		}
+		const FMaterialUniformExpressionToonMaterialSlot* OtherSlot = (const FMaterialUniformExpressionToonMaterialSlot*)OtherExpression;
+		return Input->IsIdentical(OtherSlot->Input);
+	}
+
+private:
+	TRefCountPtr<FMaterialUniformExpression> Input;
+};
@@ -0,0 +1,202 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonLightBake.cpp: CPU toon light accumulation for baking static lighting.
+=============================================================================*/
+
+#include "ToonLightBake.h"
+#include "Async/ParallelFor.h"
+
+namespace ToonShading
+{
+	void FToonBakeTexels::SetNumUninitialized(int32 NumTexels)
+	{
+		for (TArray<float>* Stream : { &PositionX, &PositionY, &PositionZ, &NormalX, &NormalY, &NormalZ, &ViewX, &ViewY, &ViewZ, &AmbientOcclusion, &ToonOffset, &ToonTerminatorRange })
+		{
+			Stream->SetNumUninitialized(NumTexels);
+		}
+		GBuffer.SetNumUninitialized(NumTexels);
+		ToonContext.SetNumUninitialized(NumTexels);
+	}
+
+	void FToonBakeTexels::SetTexel(int32 Index, const FVector& WorldPosition, const FVector& View, float InAmbientOcclusion, const FToonGBufferData& InGBuffer)
+	{
+		PositionX[Index] = WorldPosition.X;
+		PositionY[Index] = WorldPosition.Y;
+		PositionZ[Index] = WorldPosition.Z;
+		NormalX[Index] = InGBuffer.WorldNormal.X;
+		NormalY[Index] = InGBuffer.WorldNormal.Y;
+		NormalZ[Index] = InGBuffer.WorldNormal.Z;
+		ViewX[Index] = View.X;
+		ViewY[Index] = View.Y;
+		ViewZ[Index] = View.Z;
+		AmbientOcclusion[Index] = InAmbientOcclusion;
+		GBuffer[Index] = InGBuffer;
+		// Once per texel, like the deferred passes do outside of their light loop
+		ToonContext[Index] = GetToonLightingContext(InGBuffer);
+		ToonOffset[Index] = ToonContext[Index].Offset;
+		ToonTerminatorRange[Index] = ToonContext[Index].TerminatorRange;
+	}
+
+	/** What the BxDFs need from one light for the texels of a tile, indexed from the start of the tile. */
+	struct FToonBakeTileLight
+	{
+		float Visibility[ToonBakeTileSize];
+		float LightMask[ToonBakeTileSize];
+		float LX[ToonBakeTileSize];
+		float LY[ToonBakeTileSize];
+		float LZ[ToonBakeTileSize];
+		float Falloff[ToonBakeTileSize];
+		float Attenuation[ToonBakeTileSize];
+	};
+
+	/**
+	 * GetToonBakeLightMask, GetToonBakeFalloff and GetToonBakeAttenuation for the texels [Begin, End), four at a time.
+	 * The texels left over at the end of the range go through the scalar versions. TileLight.Visibility must be filled.
+	 */
+	static void ComputeToonBakeTileLight(const FToonBakeTexels& Texels, const FToonBakeLight& Light, int32 Begin, int32 End, FToonBakeTileLight& TileLight)
+	{
+		using namespace VectorMath;
+
+		const VectorRegister One = VectorOne();
+		const VectorRegister Half = VectorSetFloat1(0.5f);
+		const VectorRegister LightPositionX = VectorSetFloat1(Light.Position.X);
+		const VectorRegister LightPositionY = VectorSetFloat1(Light.Position.Y);
+		const VectorRegister LightPositionZ = VectorSetFloat1(Light.Position.Z);
+		const VectorRegister DirectionX = VectorSetFloat1(Light.Direction.X);
+		const VectorRegister DirectionY = VectorSetFloat1(Light.Direction.Y);
+		const VectorRegister DirectionZ = VectorSetFloat1(Light.Direction.Z);
+		const VectorRegister InvRadiusSqr = VectorSetFloat1(FMath::Square(Light.InvRadius));
+		const VectorRegister FalloffExponent = VectorSetFloat1(Light.FalloffExponent);
+		const VectorRegister SpotCosOuterCone = VectorSetFloat1(Light.SpotAngles.X);
+		const VectorRegister SpotInvConeDifference = VectorSetFloat1(Light.SpotAngles.Y);
+
+		int32 Index = Begin;
+		for (; Index + 4 <= End; Index += 4)
+		{
+			const int32 TileIndex = Index - Begin;
+
+			VectorRegister LX = DirectionX;
+			VectorRegister LY = DirectionY;
+			VectorRegister LZ = DirectionZ;
+			VectorRegister LightMask = One;
+			VectorRegister Falloff = One;
+			if (Light.bRadialLight)
+			{
+				LX = VectorSubtract(LightPositionX, VectorLoad(&Texels.PositionX[Index]));
+				LY = VectorSubtract(LightPositionY, VectorLoad(&Texels.PositionY[Index]));
+				LZ = VectorSubtract(LightPositionZ, VectorLoad(&Texels.PositionZ[Index]));
+				const VectorRegister DistanceSqr = Dot3(LX, LY, LZ, LX, LY, LZ);
+				const VectorRegister InvDistance = VectorReciprocalSqrtAccurate(DistanceSqr);
+				LX = VectorMultiply(LX, InvDistance);
+				LY = VectorMultiply(LY, InvDistance);
+				LZ = VectorMultiply(LZ, InvDistance);
+
+				const VectorRegister NormalizeDistanceSqr = VectorMultiply(DistanceSqr, InvRadiusSqr);
+				if (Light.bInverseSquared)
+				{
+					const VectorRegister Mask = Saturate(VectorSubtract(One, VectorMultiply(NormalizeDistanceSqr, NormalizeDistanceSqr)));
+					LightMask = VectorMultiply(Mask, Mask);
+					Falloff = VectorReciprocalAccurate(VectorAdd(DistanceSqr, One));
+				}
+				else
+				{
+					LightMask = VectorPow(VectorSubtract(One, Saturate(NormalizeDistanceSqr)), FalloffExponent);
+				}
+
+				if (Light.bSpotLight)
+				{
+					const VectorRegister ConeMask = Saturate(VectorMultiply(VectorSubtract(Dot3(LX, LY, LZ, DirectionX, DirectionY, DirectionZ), SpotCosOuterCone), SpotInvConeDifference));
+					LightMask = VectorMultiply(LightMask, VectorMultiply(ConeMask, ConeMask));
+				}
+			}
+
+			// Toon Shade
+			const VectorRegister Offset = VectorLoad(&Texels.ToonOffset[Index]);
+			const VectorRegister TerminatorRange = VectorLoad(&Texels.ToonTerminatorRange[Index]);
+			const VectorRegister SurfaceShadow = VectorMultiply(VectorLoad(&Texels.AmbientOcclusion[Index]), VectorLoad(&TileLight.Visibility[TileIndex]));
+			const VectorRegister NoL = VectorMultiply(VectorAdd(Dot3(VectorLoad(&Texels.NormalX[Index]), VectorLoad(&Texels.NormalY[Index]), VectorLoad(&Texels.NormalZ[Index]), LX, LY, LZ), One), Half);
+			const VectorRegister NoLOffset = Saturate(VectorAdd(NoL, Offset));
+			const VectorRegister LightAttenuationOffset = Saturate(VectorAdd(SurfaceShadow, Offset));
+			const VectorRegister ToonAttenuation = VectorMultiply(ToonStep(TerminatorRange, NoLOffset), ToonStep(TerminatorRange, LightAttenuationOffset));
+
+			VectorStore(LightMask, &TileLight.LightMask[TileIndex]);
+			VectorStore(LX, &TileLight.LX[TileIndex]);
+			VectorStore(LY, &TileLight.LY[TileIndex]);
+			VectorStore(LZ, &TileLight.LZ[TileIndex]);
+			VectorStore(Falloff, &TileLight.Falloff[TileIndex]);
+			VectorStore(VectorSelect(VectorCompareGE(Offset, One), One, ToonAttenuation), &TileLight.Attenuation[TileIndex]);
+		}
+
+		for (; Index < End; ++Index)
+		{
+			const int32 TileIndex = Index - Begin;
+
+			FVector L;
+			float DistanceSqr;
+			TileLight.LightMask[TileIndex] = GetToonBakeLightMask(Light, FVector(Texels.PositionX[Index], Texels.PositionY[Index], Texels.PositionZ[Index]), L, DistanceSqr);
+			TileLight.LX[TileIndex] = L.X;
+			TileLight.LY[TileIndex] = L.Y;
+			TileLight.LZ[TileIndex] = L.Z;
+			TileLight.Falloff[TileIndex] = GetToonBakeFalloff(Light, DistanceSqr);
+			TileLight.Attenuation[TileIndex] = GetToonBakeAttenuation(Texels.ToonContext[Index], Texels.GBuffer[Index].WorldNormal, L, Texels.AmbientOcclusion[Index] * TileLight.Visibility[TileIndex]);
+		}
+	}
+
+	void BakeToonLighting(const FToonBakeTexels& Texels, TArrayView<const FToonBakeLight> Lights, const FToonBakeVisibilityFunction& VisibilityFunction, FToonBakeLighting& OutLighting, bool bForceSingleThread)
+	{
+		const int32 NumTexels = Texels.Num();
+		for (TArray<float>* Channel : { &OutLighting.R, &OutLighting.G, &OutLighting.B })
+		{
+			Channel->SetNumZeroed(NumTexels);
+		}
+
+		const int32 NumTiles = FMath::DivideAndRoundUp(NumTexels, ToonBakeTileSize);
+
+		// ParallelFor hands the tiles out through a shared counter, so threads that finish early keep taking tiles from the others
+		ParallelFor(NumTiles, [&](int32 TileIndex)
+		{
+			const int32 Begin = TileIndex * ToonBakeTileSize;
+			const int32 End = FMath::Min(Begin + ToonBakeTileSize, NumTexels);
+			FToonBakeTileLight TileLight;
+
+			for (int32 LightIndex = 0; LightIndex < Lights.Num(); ++LightIndex)
+			{
+				const FToonBakeLight& Light = Lights[LightIndex];
+
+				for (int32 Index = Begin; Index < End; ++Index)
+				{
+					TileLight.Visibility[Index - Begin] = VisibilityFunction ? VisibilityFunction(Index, LightIndex) : 1.f;
+				}
+				ComputeToonBakeTileLight(Texels, Light, Begin, End, TileLight);
+
+				for (int32 Index = Begin; Index < End; ++Index)
+				{
+					const int32 TileIndex = Index - Begin;
+					const float LightMask = TileLight.LightMask[TileIndex];
+					const float TransmissionShadow = TileLight.Visibility[TileIndex];
+					const float SurfaceShadow = Texels.AmbientOcclusion[Index] * TransmissionShadow;
+					if (LightMask <= 0.f || SurfaceShadow + TransmissionShadow <= 0.f || !IsToonBakeShadingModel(Texels.GBuffer[Index].ShadingModelID))
+					{
+						continue;
+					}
+
+					const FVector Lighting = IntegrateToonBakeLight(
+						Texels.GBuffer[Index],
+						Texels.ToonContext[Index],
+						FVector(Texels.ViewX[Index], Texels.ViewY[Index], Texels.ViewZ[Index]),
+						FVector(TileLight.LX[TileIndex], TileLight.LY[TileIndex], TileLight.LZ[TileIndex]),
+						TileLight.Falloff[TileIndex],
+						Light.Color,
+						LightMask,
+						TileLight.Attenuation[TileIndex],
+						TransmissionShadow);
+
+					OutLighting.R[Index] += Lighting.X;
+					OutLighting.G[Index] += Lighting.Y;
+					OutLighting.B[Index] += Lighting.Z;
+				}
+			}
+		}, bForceSingleThread);
+	}
+}
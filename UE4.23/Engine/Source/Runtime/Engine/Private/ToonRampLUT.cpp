@@ -0,0 +1,82 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonRampLUT.cpp: Baking of the toon ramp lookup texture.
+=============================================================================*/
+
+#include "ToonRampLUT.h"
+#include "Engine/Texture2D.h"
+#include "ToonShadingReference.h"
+
+namespace ToonShading
+{
+	void GetToonRampLUTTexelCoordinates(int32 X, int32 Y, float& OutRange, float& OutInput)
+	{
+		const float V = (float)Y / (float)(ToonRampLUTSizeY - 1);
+		OutRange = V * V * ToonRampLUTMaxRange;
+		OutInput = (float)X / (float)(ToonRampLUTSizeX - 1);
+	}
+
+	void BakeToonRampLUT(TArray<FFloat16>& OutTexels)
+	{
+		BakeToonRampLUT([](float Range, float Input) { return ToonStep(Range, Input); }, OutTexels);
+	}
+
+	void BakeToonRampLUT(FToonRampFunction RampFunction, TArray<FFloat16>& OutTexels)
+	{
+		OutTexels.SetNumUninitialized(ToonRampLUTSizeX * ToonRampLUTSizeY);
+
+		for (int32 Y = 0; Y < ToonRampLUTSizeY; ++Y)
+		{
+			for (int32 X = 0; X < ToonRampLUTSizeX; ++X)
+			{
+				float Range;
+				float Input;
+				GetToonRampLUTTexelCoordinates(X, Y, Range, Input);
+				OutTexels[Y * ToonRampLUTSizeX + X] = FFloat16(RampFunction(Range, Input));
+			}
+		}
+	}
+
+	float SampleToonRampLUT(const TArray<FFloat16>& Texels, float Range, float Input)
+	{
+		check(Texels.Num() == ToonRampLUTSizeX * ToonRampLUTSizeY);
+
+		// Texel space position. Same as the scale and bias applied to the UVs in ToonRamp()
+		const float PositionX = Saturate(Input) * (ToonRampLUTSizeX - 1);
+		const float PositionY = FMath::Sqrt(Saturate(Range * (1.f / ToonRampLUTMaxRange))) * (ToonRampLUTSizeY - 1);
+
+		const int32 X0 = FMath::Min(FMath::FloorToInt(PositionX), ToonRampLUTSizeX - 2);
+		const int32 Y0 = FMath::Min(FMath::FloorToInt(PositionY), ToonRampLUTSizeY - 2);
+		const float FracX = PositionX - X0;
+		const float FracY = PositionY - Y0;
+
+		const FFloat16* Row0 = &Texels[Y0 * ToonRampLUTSizeX + X0];
+		const FFloat16* Row1 = Row0 + ToonRampLUTSizeX;
+		const float Top = FMath::Lerp(Row0[0].GetFloat(), Row0[1].GetFloat(), FracX);
+		const float Bottom = FMath::Lerp(Row1[0].GetFloat(), Row1[1].GetFloat(), FracX);
+		return FMath::Lerp(Top, Bottom, FracY);
+	}
+
+	UTexture2D* CreateToonRampTexture(const TArray<FFloat16>& Texels)
+	{
+		check(Texels.Num() == ToonRampLUTSizeX * ToonRampLUTSizeY);
+
+		UTexture2D* Texture = UTexture2D::CreateTransient(ToonRampLUTSizeX, ToonRampLUTSizeY, PF_R16F, TEXT("ToonRampLUT"));
+		if (Texture)
+		{
+			Texture->AddressX = TA_Clamp;
+			Texture->AddressY = TA_Clamp;
+			Texture->Filter = TF_Bilinear;
+			Texture->SRGB = false;
+
+			FTexture2DMipMap& Mip = Texture->PlatformData->Mips[0];
+			void* MipData = Mip.BulkData.Lock(LOCK_READ_WRITE);
+			FMemory::Memcpy(MipData, Texels.GetData(), Texels.Num() * Texels.GetTypeSize());
+			Mip.BulkData.Unlock();
+
+			Texture->UpdateResource();
+		}
+		return Texture;
+	}
+}
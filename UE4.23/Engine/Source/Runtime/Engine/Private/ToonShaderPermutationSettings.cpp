@@ -0,0 +1,157 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonShaderPermutationSettings.cpp: Per project shader permutation pruning of the toon materials.
+=============================================================================*/
+
+#include "Engine/ToonShaderPermutationSettings.h"
+#include "Misc/Crc.h"
+#include "MaterialShared.h"
+#include "MaterialShaderType.h"
+#include "MeshMaterialShaderType.h"
+#include "VertexFactory.h"
+
+UToonShaderPermutationSettings::UToonShaderPermutationSettings(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	CategoryName = TEXT("Engine");
+}
+
+static bool MatchesAnyWildcard(const TCHAR* TypeName, const TArray<FString>& Wildcards)
+{
+	const FString Name(TypeName);
+	for (const FString& Wildcard : Wildcards)
+	{
+		if (Name.MatchesWildcard(Wildcard))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint32 GetRuleShadingModelMask(const FToonShaderPermutationRule& Rule)
+{
+	uint32 Mask = 0;
+	for (const TEnumAsByte<EMaterialShadingModel> ShadingModel : Rule.ShadingModels)
+	{
+		if (ShadingModel < MSM_NUM)
+		{
+			Mask |= 1u << (uint32)ShadingModel;
+		}
+	}
+	return Mask;
+}
+
+int32 FindToonShaderPruningRule(const FMaterial& Material, const FShaderType* ShaderType, const FVertexFactoryType* VertexFactoryType)
+{
+	const TArray<FToonShaderPermutationRule>& Rules = GetDefault<UToonShaderPermutationSettings>()->Rules;
+	const uint32 ShadingModelField = Material.GetShadingModels().GetShadingModelField();
+
+	// The default materials are the fallback of every other material, they keep all their shaders
+	if (Rules.Num() == 0 || ShadingModelField == 0 || Material.IsSpecialEngineMaterial())
+	{
+		return INDEX_NONE;
+	}
+
+	const EBlendMode BlendMode = Material.GetBlendMode();
+	const bool bOpaqueOrMasked = BlendMode == BLEND_Opaque || BlendMode == BLEND_Masked;
+
+	for (int32 RuleIndex = 0; RuleIndex < Rules.Num(); ++RuleIndex)
+	{
+		const FToonShaderPermutationRule& Rule = Rules[RuleIndex];
+		if (Rule.bOpaqueAndMaskedOnly && !bOpaqueOrMasked)
+		{
+			continue;
+		}
+		if ((ShadingModelField & ~GetRuleShadingModelMask(Rule)) != 0)
+		{
+			continue;
+		}
+		if (!MatchesAnyWildcard(ShaderType->GetName(), Rule.ShaderTypes))
+		{
+			continue;
+		}
+		if (Rule.VertexFactoryTypes.Num() > 0 && (!VertexFactoryType || !MatchesAnyWildcard(VertexFactoryType->GetName(), Rule.VertexFactoryTypes)))
+		{
+			continue;
+		}
+		return RuleIndex;
+	}
+	return INDEX_NONE;
+}
+
+void AppendToonShaderPruningKeyString(FString& KeyString)
+{
+	const TArray<FToonShaderPermutationRule>& Rules = GetDefault<UToonShaderPermutationSettings>()->Rules;
+	if (Rules.Num() == 0)
+	{
+		return;
+	}
+
+	FString RulesString;
+	for (const FToonShaderPermutationRule& Rule : Rules)
+	{
+		RulesString += FString::Printf(TEXT("%08X%d|%s|%s;"), GetRuleShadingModelMask(Rule), Rule.bOpaqueAndMaskedOnly ? 1 : 0,
+			*FString::Join(Rule.ShaderTypes, TEXT(",")), *FString::Join(Rule.VertexFactoryTypes, TEXT(",")));
+	}
+	KeyString += FString::Printf(TEXT("_TOONPRUNE%08X"), FCrc::StrCrc32(*RulesString));
+}
+
+int32 GetToonShaderPruningReport(const FMaterial& Material, EShaderPlatform Platform, TArray<int32>& OutNumPrunedPerRule)
+{
+	OutNumPrunedPerRule.Reset();
+	OutNumPrunedPerRule.AddZeroed(GetDefault<UToonShaderPermutationSettings>()->Rules.Num());
+
+	int32 NumKept = 0;
+	auto CountShader = [&](const FShaderType* ShaderType, const FVertexFactoryType* VertexFactoryType)
+	{
+		const int32 RuleIndex = FindToonShaderPruningRule(Material, ShaderType, VertexFactoryType);
+		if (RuleIndex == INDEX_NONE)
+		{
+			++NumKept;
+		}
+		else
+		{
+			++OutNumPrunedPerRule[RuleIndex];
+		}
+	};
+
+	// Same permutations as FMaterial::GetDependentShaderAndVFTypes, before FMaterial::ShouldCache
+	for (TLinkedList<FVertexFactoryType*>::TIterator VertexFactoryTypeIt(FVertexFactoryType::GetTypeList()); VertexFactoryTypeIt; VertexFactoryTypeIt.Next())
+	{
+		FVertexFactoryType* VertexFactoryType = *VertexFactoryTypeIt;
+		if (!VertexFactoryType->IsUsedWithMaterials())
+		{
+			continue;
+		}
+
+		for (TLinkedList<FShaderType*>::TIterator ShaderTypeIt(FShaderType::GetTypeList()); ShaderTypeIt; ShaderTypeIt.Next())
+		{
+			FMeshMaterialShaderType* ShaderType = ShaderTypeIt->GetMeshMaterialShaderType();
+			const int32 PermutationCount = ShaderType ? ShaderType->GetPermutationCount() : 0;
+			for (int32 PermutationId = 0; PermutationId < PermutationCount; ++PermutationId)
+			{
+				if (ShaderType->ShouldCompilePermutation(Platform, &Material, VertexFactoryType, PermutationId) && VertexFactoryType->ShouldCache(Platform, &Material, ShaderType))
+				{
+					CountShader(ShaderType, VertexFactoryType);
+				}
+			}
+		}
+	}
+
+	for (TLinkedList<FShaderType*>::TIterator ShaderTypeIt(FShaderType::GetTypeList()); ShaderTypeIt; ShaderTypeIt.Next())
+	{
+		FMaterialShaderType* ShaderType = ShaderTypeIt->GetMaterialShaderType();
+		const int32 PermutationCount = ShaderType ? ShaderType->GetPermutationCount() : 0;
+		for (int32 PermutationId = 0; PermutationId < PermutationCount; ++PermutationId)
+		{
+			if (ShaderType->ShouldCompilePermutation(Platform, &Material, PermutationId))
+			{
+				CountShader(ShaderType, nullptr);
+			}
+		}
+	}
+
+	return NumKept;
+}
@@ -0,0 +1,141 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonTileClassification.cpp: CPU emulation of the toon tile classification pass.
+=============================================================================*/
+
+#include "ToonTileClassification.h"
+
+namespace ToonShading
+{
+	const TCHAR* GetToonTileClassName(EToonTileClass TileClass)
+	{
+		switch (TileClass)
+		{
+		case EToonTileClass::Standard:	return TEXT("Standard");
+		case EToonTileClass::Toon:		return TEXT("Toon");
+		case EToonTileClass::ToonSkin:	return TEXT("ToonSkin");
+		case EToonTileClass::ToonHair:	return TEXT("ToonHair");
+		case EToonTileClass::ToonAniso:	return TEXT("ToonAniso");
+		case EToonTileClass::Mixed:		return TEXT("Mixed");
+		default:						return TEXT("Unknown");
+		}
+	}
+
+	void ClassifyToonTiles(const uint8* PackedGBufferB, int32 Width, int32 Height, int32 PixelStride, int32 RowStride, FToonTileClassification& OutClassification)
+	{
+		OutClassification = FToonTileClassification();
+		OutClassification.TileCountX = FMath::DivideAndRoundUp(Width, ToonTileSize);
+		OutClassification.TileCountY = FMath::DivideAndRoundUp(Height, ToonTileSize);
+
+		for (int32 TileY = 0; TileY < OutClassification.TileCountY; ++TileY)
+		{
+			for (int32 TileX = 0; TileX < OutClassification.TileCountX; ++TileX)
+			{
+				// Same as TileClassMask in ClassifyCS
+				uint32 TileClassMask = 0;
+				int32 NumLitPixels = 0;
+
+				const int32 EndY = FMath::Min((TileY + 1) * ToonTileSize, Height);
+				const int32 EndX = FMath::Min((TileX + 1) * ToonTileSize, Width);
+				for (int32 Y = TileY * ToonTileSize; Y < EndY; ++Y)
+				{
+					const uint8* Row = PackedGBufferB + (SIZE_T)Y * RowStride;
+					for (int32 X = TileX * ToonTileSize; X < EndX; ++X)
+					{
+						const uint32 ShadingModelID = DecodeShadingModelId(Row[X * PixelStride]);
+						if (ShadingModelID != ShadingModelID_Unlit)
+						{
+							TileClassMask |= 1u << (uint32)GetToonTileClass(ShadingModelID);
+							++NumLitPixels;
+						}
+					}
+				}
+
+				if (TileClassMask == 0)
+				{
+					++OutClassification.NumEmptyTiles;
+					continue;
+				}
+
+				const int32 TileClass = FMath::CountBits(TileClassMask) == 1 ? (int32)FMath::CountTrailingZeros(TileClassMask) : (int32)EToonTileClass::Mixed;
+				OutClassification.TileLists[TileClass].Add((uint32)TileX | ((uint32)TileY << 16));
+				OutClassification.NumLitPixels[TileClass] += NumLitPixels;
+			}
+		}
+	}
+
+	/** 1 based position of a shading model in the switch of IntegrateBxDFSwitch. The ones without a case reach default after every test. */
+	static int32 GetSwitchCasePosition(uint32 ShadingModelID)
+	{
+		static const uint32 CaseOrder[] =
+		{
+			ShadingModelID_DefaultLit, ShadingModelID_Subsurface, ShadingModelID_PreintegratedSkin, ShadingModelID_ClearCoat,
+			ShadingModelID_SubsurfaceProfile, ShadingModelID_TwoSidedFoliage, ShadingModelID_Hair, ShadingModelID_Cloth, ShadingModelID_Eye,
+			ShadingModelID_Toon, ShadingModelID_ToonSkin, ShadingModelID_ToonHair, ShadingModelID_Anisotropic, ShadingModelID_ToonAniso
+		};
+		for (int32 Index = 0; Index < ARRAY_COUNT(CaseOrder); ++Index)
+		{
+			if (CaseOrder[Index] == ShadingModelID)
+			{
+				return Index + 1;
+			}
+		}
+		return ARRAY_COUNT(CaseOrder);
+	}
+
+	void SimulateWaveBxDFDispatch(const uint8* PackedGBufferB, int32 Width, int32 Height, int32 PixelStride, int32 RowStride, int32 WaveSize, FWaveBxDFDispatchStats& OutStats)
+	{
+		check(WaveSize == 32 || WaveSize == 64);
+
+		OutStats = FWaveBxDFDispatchStats();
+		OutStats.WaveSize = WaveSize;
+
+		const int32 WaveWidth = 8;
+		const int32 WaveHeight = WaveSize / WaveWidth;
+
+		for (int32 WaveY = 0; WaveY < Height; WaveY += WaveHeight)
+		{
+			for (int32 WaveX = 0; WaveX < Width; WaveX += WaveWidth)
+			{
+				// Shading model IDs fit in 5 bits
+				uint32 ShadingModelMask = 0;
+				int32 NumLitLanes = 0;
+
+				const int32 EndY = FMath::Min(WaveY + WaveHeight, Height);
+				const int32 EndX = FMath::Min(WaveX + WaveWidth, Width);
+				for (int32 Y = WaveY; Y < EndY; ++Y)
+				{
+					const uint8* Row = PackedGBufferB + (SIZE_T)Y * RowStride;
+					for (int32 X = WaveX; X < EndX; ++X)
+					{
+						const uint32 ShadingModelID = DecodeShadingModelId(Row[X * PixelStride]);
+						if (ShadingModelID != ShadingModelID_Unlit)
+						{
+							ShadingModelMask |= 1u << ShadingModelID;
+							++NumLitLanes;
+						}
+					}
+				}
+
+				if (ShadingModelMask == 0)
+				{
+					continue;
+				}
+
+				const int32 NumDistinct = FMath::CountBits(ShadingModelMask);
+				int32 LastCasePosition = 0;
+				for (uint32 Mask = ShadingModelMask; Mask != 0; Mask &= Mask - 1)
+				{
+					LastCasePosition = FMath::Max(LastCasePosition, GetSwitchCasePosition(FMath::CountTrailingZeros(Mask)));
+				}
+
+				++OutStats.NumWaves;
+				OutStats.NumUniformWaves += NumDistinct == 1 ? 1 : 0;
+				OutStats.NumLitLanes += NumLitLanes;
+				OutStats.NumBxDFPasses += NumDistinct;
+				OutStats.NumSwitchTests += LastCasePosition;
+			}
+		}
+	}
+}
@@ -0,0 +1,53 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialShaderCompileStats.h: Material shader compile cost per shading model.
+
+	STAT_ShaderCompiling_NumLitMaterialShaders counts the shaders of every lit shading model together.
+	These counters split the compile jobs FMaterialShaderMap::ProcessCompilationResults receives by
+	EMaterialShadingModel, so the cost of a single shading model (e.g. the toon ones) can be told apart.
+	Shaders loaded from the DDC are not compile jobs and are not counted.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+
+#if WITH_EDITOR
+
+/** Cumulated cost of the material shaders compiled for one shading model. */
+struct FShadingModelCompileStats
+{
+	uint32 NumJobs = 0;
+	/** Sum of the compile times reported by the shader compiler for each job. */
+	double CompileSeconds = 0.0;
+	uint64 BytecodeBytes = 0;
+	uint64 NumInstructions = 0;
+};
+
+class ENGINE_API FMaterialShaderCompileStats
+{
+public:
+	static FMaterialShaderCompileStats& Get();
+
+	/**
+	 * Records a finished compile job of a material. A material with several shading models compiles every one of them into
+	 * each of its shaders, so the job is added to each shading model of the field; the per model totals then add up to more
+	 * than the number of jobs.
+	 */
+	void AddJob(FMaterialShadingModelField ShadingModels, double CompileSeconds, uint32 BytecodeBytes, uint32 NumInstructions);
+
+	FShadingModelCompileStats GetStats(EMaterialShadingModel ShadingModel) const;
+
+	void Reset();
+
+	/** One row per shading model that had jobs. */
+	FString ToCSV() const;
+
+private:
+	mutable FCriticalSection CriticalSection;
+	FShadingModelCompileStats Stats[MSM_NUM];
+};
+
+#endif // WITH_EDITOR
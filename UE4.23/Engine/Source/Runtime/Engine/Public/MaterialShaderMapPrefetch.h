@@ -0,0 +1,73 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	MaterialShaderMapPrefetch.h: Batched asynchronous DDC requests of material shader maps.
+
+	FMaterialShaderMap::LoadFromDerivedDataCache blocks on one DDC request per material resource.
+	Code about to cache the shaders of many resources requests all of their shader maps first: the DDC
+	fetches them in parallel on its own threads, and LoadFromDerivedDataCache then takes the payloads
+	that already arrived instead of issuing a synchronous request.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHIDefinitions.h"
+
+#if WITH_EDITOR
+
+class FMaterial;
+class FMaterialShaderMapId;
+
+class ENGINE_API FMaterialShaderMapPrefetcher
+{
+public:
+	static FMaterialShaderMapPrefetcher& Get();
+
+	/**
+	 * Requests the shader map FMaterial::CacheShaders(Platform) would load from the DDC for Material.
+	 * Does nothing outside of a FMaterialShaderMapPrefetchScope, or if the shader map is already complete in memory.
+	 */
+	void Prefetch(const FMaterial& Material, EShaderPlatform Platform);
+
+	/** Requests a shader map from the DDC. Does nothing outside of a FMaterialShaderMapPrefetchScope. */
+	void Prefetch(const FMaterialShaderMapId& ShaderMapId, EShaderPlatform Platform);
+
+	/**
+	 * Hands over the result of a prefetched request, waiting for it if it is still in flight.
+	 * @param DataKey	Shader map DDC key
+	 * @param bOutFound	Whether the DDC had the shader map
+	 * @return false if DataKey was not prefetched
+	 */
+	bool Take(const FString& DataKey, bool& bOutFound, TArray<uint8>& OutData);
+
+private:
+	friend class FMaterialShaderMapPrefetchScope;
+
+	void BeginScope();
+	/** Drops the requests nobody took once the outermost scope ends. */
+	void EndScope();
+
+	/** Shader maps can be cached from the async loading thread as well. */
+	FCriticalSection CriticalSection;
+	/** DDC key to asynchronous request handle. */
+	TMap<FString, uint32> PendingRequests;
+	int32 ScopeDepth = 0;
+};
+
+/** Prefetched shader maps are kept while a scope is open, so that payloads nobody asks for do not pile up. Scopes can be nested. */
+class FMaterialShaderMapPrefetchScope
+{
+public:
+	FMaterialShaderMapPrefetchScope()
+	{
+		FMaterialShaderMapPrefetcher::Get().BeginScope();
+	}
+
+	~FMaterialShaderMapPrefetchScope()
+	{
+		FMaterialShaderMapPrefetcher::Get().EndScope();
+	}
+};
+
+#endif // WITH_EDITOR
@@ -0,0 +1,216 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonLightBake.h: CPU toon light accumulation for baking static lighting.
+
+	Reproduces the toon part of the light loop of GetDynamicLighting (DeferredLightingCommon.ush):
+	the toon attenuation, IntegrateBxDF for point, spot and directional lights and the LightAccumulator_Add
+	multipliers of each toon shading model, so that lighting baked offline matches the deferred passes.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include "ToonShadingReference.h"
+
+namespace ToonShading
+{
+	/**
+	 * Subset of FDeferredLightData needed for point, spot and directional lights. Rect lights, the source radius and length of
+	 * the capsule shape, IES profiles and light functions are not handled: every light is baked as a point or a direction.
+	 */
+	struct FToonBakeLight
+	{
+		/** Radial lights only. */
+		FVector Position = FVector::ZeroVector;
+		/** Directional and spot lights. Normalized, pointing towards the light like FDeferredLightData::Direction. */
+		FVector Direction = FVector(0.f, 0.f, 1.f);
+		FVector Color = FVector::ZeroVector;
+		float InvRadius = 0.f;
+		float FalloffExponent = 8.f;
+		/** Spot lights only. Cosine of the outer cone angle and 1 / (cosine of the inner cone angle - X), like FDeferredLightData::SpotAngles. */
+		FVector2D SpotAngles = FVector2D(-2.f, 1.f);
+		bool bRadialLight = false;
+		bool bSpotLight = false;
+		bool bInverseSquared = true;
+	};
+
+	/**
+	 * Texels to bake. The streams the light mask and the toon attenuation read for every light are stored as structure of arrays,
+	 * BakeToonLighting evaluates them four texels at a time. The BxDFs run per texel on the GBuffer and the toon context, which
+	 * stay arrays of structures.
+	 */
+	struct FToonBakeTexels
+	{
+		TArray<float> PositionX, PositionY, PositionZ;
+		/** GBuffer.WorldNormal, filled by SetTexel. */
+		TArray<float> NormalX, NormalY, NormalZ;
+		/** Normalized. */
+		TArray<float> ViewX, ViewY, ViewZ;
+		/** AmbientOcclusion passed to GetDynamicLighting. */
+		TArray<float> AmbientOcclusion;
+		/** ToonContext.Offset and ToonContext.TerminatorRange, filled by SetTexel. */
+		TArray<float> ToonOffset, ToonTerminatorRange;
+		TArray<FToonGBufferData> GBuffer;
+		/** GetToonLightingContext(GBuffer), filled by SetTexel. */
+		TArray<FToonLightingContext> ToonContext;
+
+		ENGINE_API void SetNumUninitialized(int32 NumTexels);
+		int32 Num() const { return GBuffer.Num(); }
+
+		/** @param View	Direction from the texel towards the viewer, -CameraVector in GetDynamicLighting */
+		ENGINE_API void SetTexel(int32 Index, const FVector& WorldPosition, const FVector& View, float InAmbientOcclusion, const FToonGBufferData& InGBuffer);
+	};
+
+	/** Baked lighting, one entry per texel in each channel. */
+	struct FToonBakeLighting
+	{
+		TArray<float> R, G, B;
+
+		FVector GetTexel(int32 Index) const { return FVector(R[Index], G[Index], B[Index]); }
+	};
+
+	/** Fraction of a light reaching a texel, 0 to 1. Stands in for the shadow maps GetShadowTerms reads. */
+	typedef TFunction<float(int32 TexelIndex, int32 LightIndex)> FToonBakeVisibilityFunction;
+
+	/** Port of GetLocalLightAttenuation without the rect term. @param OutL direction to the light */
+	inline float GetToonBakeLightMask(const FToonBakeLight& Light, const FVector& WorldPosition, FVector& OutL, float& OutDistanceSqr)
+	{
+		if (!Light.bRadialLight)
+		{
+			OutL = Light.Direction;
+			OutDistanceSqr = 1.f;
+			return 1.f;
+		}
+
+		const FVector ToLight = Light.Position - WorldPosition;
+		OutDistanceSqr = ToLight.SizeSquared();
+		OutL = ToLight * FMath::InvSqrt(OutDistanceSqr);
+
+		float LightMask;
+		if (Light.bInverseSquared)
+		{
+			LightMask = FMath::Square(Saturate(1.f - FMath::Square(OutDistanceSqr * FMath::Square(Light.InvRadius))));
+		}
+		else
+		{
+			// RadialAttenuation
+			const FVector WorldLightVector = ToLight * Light.InvRadius;
+			const float NormalizeDistanceSquared = WorldLightVector.SizeSquared();
+			LightMask = FMath::Pow(1.f - Saturate(NormalizeDistanceSquared), Light.FalloffExponent);
+		}
+
+		if (Light.bSpotLight)
+		{
+			// SpotAttenuation
+			LightMask *= FMath::Square(Saturate((FVector::DotProduct(OutL, Light.Direction) - Light.SpotAngles.X) * Light.SpotAngles.Y));
+		}
+		return LightMask;
+	}
+
+	/** IntegrateBxDF(Capsule): DistBiasSqr is 1, and the falloff only applies to inverse squared lights. */
+	FORCEINLINE float GetToonBakeFalloff(const FToonBakeLight& Light, float DistanceSqr)
+	{
+		return Light.bInverseSquared && Light.bRadialLight ? 1.f / (DistanceSqr + 1.f) : 1.f;
+	}
+
+	/** The "Toon Shade" attenuation of GetDynamicLighting. @param SurfaceShadow	Shadow.SurfaceShadow */
+	FORCEINLINE float GetToonBakeAttenuation(const FToonLightingContext& ToonContext, const FVector& N, const FVector& L, float SurfaceShadow)
+	{
+		if (ToonContext.Offset >= 1.f)
+		{
+			return 1.f;
+		}
+		const float NoL = (FVector::DotProduct(N, L) + 1.f) / 2.f;
+		const float NoLOffset = Saturate(NoL + ToonContext.Offset);
+		const float LightAttenuationOffset = Saturate(SurfaceShadow + ToonContext.Offset);
+		const float ToonSurfaceShadow = ToonStep(ToonContext.TerminatorRange, LightAttenuationOffset);
+		return ToonStep(ToonContext.TerminatorRange, NoLOffset) * ToonSurfaceShadow;
+	}
+
+	FORCEINLINE bool IsToonBakeShadingModel(uint32 ShadingModelID)
+	{
+		return ShadingModelID == ShadingModelID_Toon || ShadingModelID == ShadingModelID_ToonSkin || ShadingModelID == ShadingModelID_ToonHair || ShadingModelID == ShadingModelID_ToonAniso;
+	}
+
+	/**
+	 * The IntegrateBxDF and LightAccumulator_Add part of the light loop body of GetDynamicLighting, for a toon texel the light reaches.
+	 * @param TransmissionShadow	Shadow.TransmissionShadow
+	 */
+	inline FVector IntegrateToonBakeLight(const FToonGBufferData& GBuffer, const FToonLightingContext& ToonContext, const FVector& V, const FVector& L, float Falloff, const FVector& LightColor, float LightMask, float Attenuation, float TransmissionShadow)
+	{
+		const uint32 ShadingModelID = GBuffer.ShadingModelID;
+		const FVector& N = GBuffer.WorldNormal;
+		const FVector FalloffColor(1.f);
+
+		FToonDirectLighting Lighting;
+		float ToonScale;
+		if (ShadingModelID == ShadingModelID_ToonHair)
+		{
+			Lighting = ToonHairBxDF(GBuffer, N, V, L, Falloff, FalloffColor);
+			ToonScale = 1.f;
+		}
+		else
+		{
+			if (ShadingModelID == ShadingModelID_ToonSkin)
+			{
+				Lighting = ToonSkinBxDF(GBuffer, ToonContext, N, V, L, Falloff, FalloffColor);
+			}
+			else if (ShadingModelID == ShadingModelID_ToonAniso)
+			{
+				Lighting = ToonAnisoBxDF(GBuffer, ToonContext, N, V, L, Falloff, FalloffColor);
+			}
+			else
+			{
+				Lighting = ToonBxDF(GBuffer, ToonContext, N, V, L, Falloff, FalloffColor);
+			}
+			ToonScale = 0.25f;
+		}
+
+		// LightAccumulator_Add for the toon models, then for the transmission
+		return (Lighting.Diffuse + Lighting.Specular) * LightColor * (LightMask * Attenuation * ToonScale)
+			+ Lighting.Transmission * LightColor * (LightMask * TransmissionShadow);
+	}
+
+	/**
+	 * Port of the light loop body of GetDynamicLighting for the toon shading models, light shape reduced to a point (capsule with no
+	 * length nor radius). Texels of other shading models get no light. BakeToonLighting computes the same four texels at a time.
+	 * @param Visibility	Shadowing of the light, applied as Shadow.SurfaceShadow = AmbientOcclusion * Visibility and
+	 *						Shadow.TransmissionShadow = Visibility
+	 */
+	inline FVector GetToonDynamicLighting(const FToonGBufferData& GBuffer, const FToonLightingContext& ToonContext, const FVector& WorldPosition, const FVector& V, float AmbientOcclusion, const FToonBakeLight& Light, float Visibility)
+	{
+		if (!IsToonBakeShadingModel(GBuffer.ShadingModelID))
+		{
+			return FVector::ZeroVector;
+		}
+
+		FVector L;
+		float DistanceSqr;
+		const float LightMask = GetToonBakeLightMask(Light, WorldPosition, L, DistanceSqr);
+
+		const float SurfaceShadow = AmbientOcclusion * Visibility;
+		const float TransmissionShadow = Visibility;
+		if (LightMask <= 0.f || SurfaceShadow + TransmissionShadow <= 0.f)
+		{
+			return FVector::ZeroVector;
+		}
+
+		const float Attenuation = GetToonBakeAttenuation(ToonContext, GBuffer.WorldNormal, L, SurfaceShadow);
+		return IntegrateToonBakeLight(GBuffer, ToonContext, V, L, GetToonBakeFalloff(Light, DistanceSqr), Light.Color, LightMask, Attenuation, TransmissionShadow);
+	}
+
+	/** Texels per task of BakeToonLighting. Small enough to balance the threads, large enough for a light to stay in cache over a tile. */
+	static const int32 ToonBakeTileSize = 256;
+
+	/**
+	 * Accumulates every light into every texel. Tiles of ToonBakeTileSize texels are handed out to the task graph threads by
+	 * ParallelFor, each tile looping over the lights with the texels innermost. For each light, the light mask, the direction,
+	 * the falloff and the toon attenuation of the tile are computed four texels at a time with VectorRegister, then the BxDFs
+	 * run texel by texel on the texels the light reaches.
+	 * @param VisibilityFunction	Optional, lights are unshadowed without it
+	 * @param bForceSingleThread	Runs the tiles on the calling thread, to measure the scaling
+	 */
+	ENGINE_API void BakeToonLighting(const FToonBakeTexels& Texels, TArrayView<const FToonBakeLight> Lights, const FToonBakeVisibilityFunction& VisibilityFunction, FToonBakeLighting& OutLighting, bool bForceSingleThread = false);
+}
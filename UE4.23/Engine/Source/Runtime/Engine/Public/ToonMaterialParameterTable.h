@@ -0,0 +1,82 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonMaterialParameterTable.h: Per material toon parameters read by the deferred lighting passes.
+
+	Toon materials whose toon inputs are all constants or parameters do not store them in the GBuffer
+	when r.Toon.MaterialParameterTable is set. Each of their render proxies gets a slot in this table,
+	only the slot is written to CustomData.xy and the lighting passes fetch the parameters from
+	ToonMaterialParametersTexture. See TOON_MATERIAL_PARAMETER_TABLE in ToonShadersCommon.ush.
+
+	The table has r.Toon.MaterialParameterTable.Size slots. The proxies that find it full shade with
+	the parameters of slot 0, and are counted by STAT_ToonMaterialSlotOverflows.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderResource.h"
+#include "RHI.h"
+#include "ToonShadingReference.h"
+
+class FMaterialRenderProxy;
+class FShaderCompilerEnvironment;
+
+/**
+ * Compiles r.Toon.MaterialParameterTable in. Off until the renderer binds GetTexture() to View.ToonMaterialParametersTexture and the deferred
+ * lighting global shaders call SetToonMaterialParameterTableDefine(): without both, a table material fails to compile in the base pass, or
+ * its slot is decoded as shadow intensity and specular offset by the lighting passes.
+ */
+#ifndef WITH_TOON_MATERIAL_PARAMETER_TABLE
+#define WITH_TOON_MATERIAL_PARAMETER_TABLE 0
+#endif
+
+/** Whether r.Toon.MaterialParameterTable is set. Always false without WITH_TOON_MATERIAL_PARAMETER_TABLE. */
+ENGINE_API bool IsToonMaterialParameterTableEnabled();
+
+/**
+ * Sets TOON_MATERIAL_PARAMETER_TABLE from r.Toon.MaterialParameterTable. Called by FMaterial::SetupMaterialEnvironment for the base pass,
+ * and to be called by the ModifyCompilationEnvironment of the global shaders that decode the toon GBuffer.
+ */
+ENGINE_API void SetToonMaterialParameterTableDefine(FShaderCompilerEnvironment& OutEnvironment);
+
+class ENGINE_API FToonMaterialParameterTable : public FRenderResource
+{
+public:
+	FToonMaterialParameterTable();
+
+	/**
+	 * Finds or allocates the slot of a render proxy and sets its entry. Called from the uniform expression evaluation of the proxy,
+	 * so it runs again whenever one of the material's parameters changes.
+	 * @param Inputs	CustomData0, CustomData1, SpecularOffset and SpecularRange of the material
+	 * @return the slot encoded for CustomData.xy
+	 */
+	FVector2D UpdateSlot(const FMaterialRenderProxy* MaterialRenderProxy, const FLinearColor& Inputs);
+
+	/** Frees the slot of a render proxy being released, if it has one. */
+	void ReleaseSlot(const FMaterialRenderProxy* MaterialRenderProxy);
+
+	/** 1 x r.Toon.MaterialParameterTable.Size float4 texture to bind as ToonMaterialParametersTexture, uploaded again when an entry changed. */
+	FRHITexture2D* GetTexture(FRHICommandListImmediate& RHICmdList);
+
+	//~ Begin FRenderResource Interface
+	virtual void ReleaseDynamicRHI() override;
+	//~ End FRenderResource Interface
+
+private:
+	/** Sizes the table from r.Toon.MaterialParameterTable.Size on first use, once the cvar has its configured value. */
+	void InitEntries();
+
+	/** UpdateSlot runs on the parallel rendering threads. */
+	FCriticalSection CriticalSection;
+	TMap<const FMaterialRenderProxy*, int32> Slots;
+	TArray<int32> FreeSlots;
+	TArray<FLinearColor> Entries;
+	/** Proxies that found the table full, until they are released. */
+	TSet<const FMaterialRenderProxy*> OverflowedProxies;
+	bool bEntriesDirty;
+	bool bLoggedOverflow;
+	FTexture2DRHIRef Texture;
+};
+
+extern ENGINE_API TGlobalResource<FToonMaterialParameterTable> GToonMaterialParameterTable;
@@ -0,0 +1,48 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonRampLUT.h: Baking of the toon ramp lookup texture used when TOON_RAMP_LUT is enabled.
+
+	The LUT replaces ToonStep (ShadingModels.ush) in the toon lighting paths with a single
+	bilinear fetch. X is the ramp input (NoLOffset, shadow, specular D), Y is the ramp Range
+	stored as sqrt(Range / MaxRange) so that the narrow, close to hard step ramps get most
+	of the rows.
+
+	With the default ToonStep ramp, 512x64 texels and an R16F format, the bilinear fetch is
+	within 0.01 of ToonStep for any Range >= 0.01, and within 0.004 for Range >= 0.02.
+	Below that the ramp is narrower than a texel and the difference is confined to the
+	texel that straddles the terminator.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+
+class UTexture2D;
+
+namespace ToonShading
+{
+	/** Must match TOON_RAMP_LUT_SIZE_X, TOON_RAMP_LUT_SIZE_Y and TOON_RAMP_LUT_MAX_RANGE in ShadingModels.ush */
+	static const int32 ToonRampLUTSizeX = 512;
+	static const int32 ToonRampLUTSizeY = 64;
+	static const float ToonRampLUTMaxRange = 0.5f;
+
+	/** Ramp evaluated for every texel: returns the ramp value for the given Range and Input. */
+	typedef TFunctionRef<float(float Range, float Input)> FToonRampFunction;
+
+	/** Range and Input at the center of the given texel. */
+	ENGINE_API void GetToonRampLUTTexelCoordinates(int32 X, int32 Y, float& OutRange, float& OutInput);
+
+	/** Bakes ToonStep, the ramp the toon BxDFs evaluate analytically. Texels are row major, ToonRampLUTSizeX * ToonRampLUTSizeY. */
+	ENGINE_API void BakeToonRampLUT(TArray<FFloat16>& OutTexels);
+
+	/** Bakes an arbitrary ramp, e.g. an artist authored curve, into the same layout. */
+	ENGINE_API void BakeToonRampLUT(FToonRampFunction RampFunction, TArray<FFloat16>& OutTexels);
+
+	/** Bilinear lookup with the same addressing as ToonRamp() in ShadingModels.ush. */
+	ENGINE_API float SampleToonRampLUT(const TArray<FFloat16>& Texels, float Range, float Input);
+
+	/** Creates a transient PF_R16F texture holding the baked texels, with clamped bilinear sampling. */
+	ENGINE_API UTexture2D* CreateToonRampTexture(const TArray<FFloat16>& Texels);
+}
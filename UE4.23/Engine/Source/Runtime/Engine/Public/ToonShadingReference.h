@@ -0,0 +1,1101 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonShadingReference.h: Host side reference implementation of the toon BxDFs.
+
+	Mirrors ToonStep, RoughnessToToonRange, GetToonDiffuseBoost, GetToonLightingContext, ToonBxDF, ToonSkinBxDF and ToonHairBxDF
+	from /Engine/Private/ShadingModels.ush together with the GBuffer decode helpers from
+	/Engine/Private/ToonShadersCommon.ush, so that toon shading can be evaluated and
+	regression tested without a GPU.
+
+	Any change to the shader versions of these functions must be mirrored here.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace ToonShading
+{
+	/** Must match SHADINGMODELID_* in ShadingCommon.ush */
+	enum EToonShadingModelID : uint32
+	{
+		ShadingModelID_Unlit				= 0,
+		ShadingModelID_DefaultLit			= 1,
+		ShadingModelID_Subsurface			= 2,
+		ShadingModelID_PreintegratedSkin	= 3,
+		ShadingModelID_ClearCoat			= 4,
+		ShadingModelID_SubsurfaceProfile	= 5,
+		ShadingModelID_TwoSidedFoliage		= 6,
+		ShadingModelID_Hair					= 7,
+		ShadingModelID_Cloth				= 8,
+		ShadingModelID_Eye					= 9,
+		ShadingModelID_Toon					= 10,
+		ShadingModelID_ToonSkin				= 11,
+		ShadingModelID_ToonHair				= 12,
+		ShadingModelID_ToonAniso			= 13,
+		ShadingModelID_Anisotropic			= 14,
+	};
+
+	/** Must match SHADINGMODELID_MASK in ShadingCommon.ush */
+	static const uint32 ShadingModelIDMask = 0x1F;
+
+	/** Port of DecodeShadingModelId for GBufferB.a as stored in an 8 bit channel. */
+	FORCEINLINE uint32 DecodeShadingModelId(uint8 PackedChannel)
+	{
+		return PackedChannel & ShadingModelIDMask;
+	}
+
+	/** Subset of FGBufferData (DeferredShadingCommon.ush) read by the toon BxDFs. */
+	struct FToonGBufferData
+	{
+		FVector WorldNormal;
+		FVector BaseColor;
+		FVector DiffuseColor;
+		FVector SpecularColor;
+		float Metallic;
+		float Specular;
+		float Roughness;
+		/** GBufferB.r as written by the base pass, before DiffuseColor/SpecularColor derivation. */
+		float StoredMetallic;
+		float GBufferAO;
+		FVector4 CustomData;
+		uint32 ShadingModelID;
+	};
+
+	/** Mirrors FDirectLighting. */
+	struct FToonDirectLighting
+	{
+		FVector Diffuse;
+		FVector Specular;
+		FVector Transmission;
+	};
+
+	/** HLSL saturate(). Maps NaN to 0 like GPU hardware does, which matters for ToonStep with a zero range. */
+	FORCEINLINE float Saturate(float X)
+	{
+		return X > 0.f ? (X < 1.f ? X : 1.f) : 0.f;
+	}
+
+	/** HLSL smoothstep(). Unlike FMath::SmoothStep this keeps the GPU behavior when Min == Max. */
+	FORCEINLINE float HLSLSmoothStep(float Min, float Max, float X)
+	{
+		const float T = Saturate((X - Min) / (Max - Min));
+		return T * T * (3.f - 2.f * T);
+	}
+
+	FORCEINLINE float ToonStep(float Range, float Input)
+	{
+		return HLSLSmoothStep(0.5f - Range, 0.5f + Range, Input);
+	}
+
+	FORCEINLINE float RoughnessToToonRange(float Roughness)
+	{
+		return Saturate(Roughness - 0.5f);
+	}
+
+	/** Used for matching up with standard shading model brightness */
+	FORCEINLINE float GetToonDiffuseBoost()
+	{
+		return 2.2f;
+	}
+
+	FORCEINLINE float D_GGX(float a2, float NoH)
+	{
+		const float d = (NoH * a2 - NoH) * NoH + 1.f;
+		return a2 / (PI * d * d);
+	}
+
+	FORCEINLINE FVector Diffuse_Lambert(const FVector& DiffuseColor)
+	{
+		return DiffuseColor * (1.f / PI);
+	}
+
+	/** Port of D_GGXaniso from BRDF.ush. */
+	FORCEINLINE float D_GGXaniso(float ax, float ay, float NoH, const FVector& H, const FVector& X, const FVector& Y)
+	{
+		const float XoH = FVector::DotProduct(X, H);
+		const float YoH = FVector::DotProduct(Y, H);
+		const float d = XoH * XoH / (ax * ax) + YoH * YoH / (ay * ay) + NoH * NoH;
+		return 1.f / (PI * ax * ay * d * d);
+	}
+
+	/** Port of Luminance from Common.ush. */
+	FORCEINLINE float Luminance(const FVector& LinearColor)
+	{
+		return FVector::DotProduct(LinearColor, FVector(0.3f, 0.59f, 0.11f));
+	}
+
+	/** Port of OctahedronToUnitVector from DeferredShadingCommon.ush. */
+	inline FVector OctahedronToUnitVector(const FVector2D& Oct)
+	{
+		FVector N(Oct.X, Oct.Y, 1.f - FMath::Abs(Oct.X) - FMath::Abs(Oct.Y));
+		if (N.Z < 0.f)
+		{
+			const float X = (1.f - FMath::Abs(N.Y)) * (N.X >= 0.f ? 1.f : -1.f);
+			const float Y = (1.f - FMath::Abs(N.X)) * (N.Y >= 0.f ? 1.f : -1.f);
+			N.X = X;
+			N.Y = Y;
+		}
+		return N.GetUnsafeNormal();
+	}
+
+	/*------------------------------------------------------------------------------
+		ToonShadersCommon.ush
+	------------------------------------------------------------------------------*/
+
+	FORCEINLINE float EncodeUnitVectorToFloat(FVector2D N)
+	{
+		N = N.GetSafeNormal();
+		const float Result = (N.Y > 0.f) ? (N.X + 1.1f) : N.X;
+		return Result / 1.1f;
+	}
+
+	FORCEINLINE FVector2D DecodeUnitVectorFromFloat(float X)
+	{
+		FVector2D N;
+		N.X = X * 1.1f;
+		if (X > 1.f)
+		{
+			N.X = N.X - 1.1f;
+			N.Y = -1.f * FMath::Sqrt(1.f - N.X * N.X);
+		}
+		else
+		{
+			N.Y = FMath::Sqrt(1.f - N.X * N.X);
+		}
+		return N.GetSafeNormal();
+	}
+
+	FORCEINLINE float EncodeUnitVectorToAngle(const FVector2D& N)
+	{
+		return FMath::Atan2(N.Y, N.X) * (0.5f / PI) + 0.5f;
+	}
+
+	FORCEINLINE FVector2D DecodeUnitVectorFromAngle(float X)
+	{
+		FVector2D N;
+		FMath::SinCos(&N.Y, &N.X, X * (2.f * PI) - PI);
+		return N;
+	}
+
+	inline FVector HUEtoRGB(float H)
+	{
+		const float R = FMath::Abs(H * 6.f - 3.f) - 1.f;
+		const float G = 2.f - FMath::Abs(H * 6.f - 2.f);
+		const float B = 2.f - FMath::Abs(H * 6.f - 4.f);
+		return FVector(Saturate(R), Saturate(G), Saturate(B));
+	}
+
+	inline FVector RGBtoHCV(const FVector& RGB)
+	{
+		const float Epsilon = 1e-10f;
+		// Based on work by Sam Hocevar and Emil Persson
+		const FVector4 P = (RGB.Y < RGB.Z) ? FVector4(RGB.Z, RGB.Y, -1.f, 2.f / 3.f) : FVector4(RGB.Y, RGB.Z, 0.f, -1.f / 3.f);
+		const FVector4 Q = (RGB.X < P.X) ? FVector4(P.X, P.Y, P.W, RGB.X) : FVector4(RGB.X, P.Y, P.Z, P.X);
+		const float C = Q.X - FMath::Min(Q.W, Q.Y);
+		const float H = FMath::Abs((Q.W - Q.Y) / (6.f * C + Epsilon) + Q.Z);
+		return FVector(H, C, Q.X);
+	}
+
+	inline FVector RGBtoHSV(const FVector& RGB)
+	{
+		const float Epsilon = 1e-10f;
+		const FVector HCV = RGBtoHCV(RGB);
+		const float S = HCV.Y / (HCV.Z + Epsilon);
+		return FVector(HCV.X, S, HCV.Z);
+	}
+
+	inline FVector HSVtoRGB(const FVector& HSV)
+	{
+		const FVector RGB = HUEtoRGB(HSV.X);
+		return ((RGB - FVector(1.f)) * HSV.Y + FVector(1.f)) * HSV.Z;
+	}
+
+	FORCEINLINE float EncodeSOffset(float S, float SatD, float ValRD)
+	{
+		const float RawOffset = FMath::Fmod(S, (1.f / SatD));
+		const float A = 1.f / (SatD * ValRD);
+		const float B = 1.f / ValRD;
+		return FMath::FloorToFloat((RawOffset / A) * B);
+	}
+
+	FORCEINLINE float DecodeV(float HVy, float ValRD)
+	{
+		const float SOffset = FMath::FloorToFloat(HVy * ValRD) * (1.f / ValRD);
+		return (HVy - SOffset) * ValRD;
+	}
+
+	FORCEINLINE float DecodeSAdd(float HVy, float SatD, float ValRD)
+	{
+		const float SOffset = FMath::FloorToFloat(HVy * ValRD) / ValRD;
+		return SOffset / SatD;
+	}
+
+	inline FVector2D EncodeColor2D(FVector RGB)
+	{
+		const float SatD = 8.f;
+		const float ValRD = 10.f;
+
+		const float A = 0.0025f;
+		const float B = 0.9900f;
+		RGB = FVector(FMath::Clamp(RGB.X, A, B), FMath::Clamp(RGB.Y, A, B), FMath::Clamp(RGB.Z, A, B));
+		const FVector HSV = RGBtoHSV(RGB);
+
+		const float S = FMath::FloorToFloat(SatD * HSV.Y) / SatD;
+		const float H = (HSV.X / SatD) + S;
+		const float SOffset = EncodeSOffset(HSV.Y, SatD, ValRD);
+		const float V = HSV.Z / ValRD + SOffset;
+
+		return FVector2D(H, V);
+	}
+
+	inline FVector DecodeColor2D(const FVector2D& HV)
+	{
+		const float SatM = 8.f;
+		const float SatD = 1.f / SatM;
+		const float ValRD = 10.f;
+
+		const float OutH = FMath::Fmod(HV.X, SatD) * SatM;
+		const float OutV = DecodeV(HV.Y, ValRD);
+		const float SAdd = DecodeSAdd(HV.Y, SatD, ValRD);
+		const float OutS = (FMath::FloorToFloat((HV.X / SatD)) / SatM) + SAdd;
+
+		return HSVtoRGB(FVector(OutH, OutS, OutV));
+	}
+
+	FORCEINLINE float EncodeSpecRange(float Xi, float Yi)
+	{
+		const float Div = 8.f;
+		Xi = Saturate(Xi) * 0.97f + 0.015f;
+		Yi = Saturate(Yi) * 0.8f;
+
+		const float Offset = FMath::FloorToFloat(Yi * Div) / Div;
+		const float Range = Xi / Div;
+		return Offset + Range;
+	}
+
+	FORCEINLINE FVector2D DecodeSpecRange(float InputVal)
+	{
+		const float HY = FMath::Fmod(FMath::FloorToFloat(InputVal * 8.f), 8.f) * 0.125f;
+		float HX = (InputVal - HY) * 8.f;
+		HX = HX * (1.f / 0.98f) - 0.01f;
+		return FVector2D(HX, HY);
+	}
+
+	FORCEINLINE float EncodeSSSModeSwitch(float Xi, float Yi)
+	{
+		const float Div = 2.f;
+		const float Div2 = 2.1f;
+		Yi = FMath::Clamp(Yi, 0.f, 0.99f);
+		const float Offset = FMath::FloorToFloat(Yi * Div) / Div;
+		const float Range = Xi / Div2;
+		return (Offset + Range) / 1.5f;
+	}
+
+	FORCEINLINE FVector2D DecodeSSSModeSwitch(float InputVal)
+	{
+		InputVal = InputVal * 1.5f;
+		const float HY = FMath::Fmod(FMath::FloorToFloat(InputVal * 2.f), 2.f) * 0.5f;
+		const float HX = (InputVal - HY) * 2.1f;
+		return FVector2D(HX, HY);
+	}
+
+	/** Port of EncodeSpecRangeBits, the TOON_INTEGER_GBUFFER_PACKING layout: 3 bit range step above a 5 bit offset in one 8 bit channel. */
+	FORCEINLINE float EncodeSpecRangeBits(float Xi, float Yi)
+	{
+		const uint32 Offset = (uint32)(Saturate(Xi) * 31.f + 0.5f);
+		const uint32 Range = (uint32)(Saturate(Yi) * 0.8f * 8.f);
+		return (float)((Range << 5) | Offset) / 255.f;
+	}
+
+	FORCEINLINE FVector2D DecodeSpecRangeBits(float InputVal)
+	{
+		const uint32 Bits = (uint32)(InputVal * 255.f + 0.5f);
+		return FVector2D((Bits & 0x1F) * (1.f / 31.f), (Bits >> 5) * 0.125f);
+	}
+
+	/** Port of EncodeSSSModeSwitchBits: 1 bit SSS mode above a 7 bit offset, the same layout as Encode71. */
+	FORCEINLINE float EncodeSSSModeSwitchBits(float Xi, float Yi)
+	{
+		const uint32 Offset = (uint32)(Saturate(Xi) * 127.f + 0.5f);
+		const uint32 Mode = Yi >= 0.5f ? 1 : 0;
+		return (float)((Mode << 7) | Offset) / 255.f;
+	}
+
+	FORCEINLINE FVector2D DecodeSSSModeSwitchBits(float InputVal)
+	{
+		const uint32 Bits = (uint32)(InputVal * 255.f + 0.5f);
+		return FVector2D((Bits & 0x7F) * (1.f / 127.f), (Bits >> 7) * 0.5f);
+	}
+
+	/** TOON_MATERIAL_PARAMETER_TABLE: slots addressable by CustomData.xy, 7 bits above the slot flag in x and 8 bits in y. */
+	static const int32 MaxToonMaterialSlots = 1 << 15;
+
+	/** CustomData.xy of a Toon material using the slot, read back by DecodeToonMaterialSlot. */
+	FORCEINLINE FVector2D EncodeToonMaterialSlot(int32 Slot)
+	{
+		checkSlow(Slot >= 0 && Slot < MaxToonMaterialSlots);
+		return FVector2D((float)(((Slot & 0x7F) << 1) | 1) / 255.f, (float)(Slot >> 7) / 255.f);
+	}
+
+	/** Port of EncodeToonShadowIntensity: CustomData.x of a Toon material that does not use a slot. */
+	FORCEINLINE float EncodeToonShadowIntensity(float ShadowIntensity)
+	{
+		return FMath::RoundToFloat(Saturate(ShadowIntensity) * 127.f) * (2.f / 255.f);
+	}
+
+	/** Port of DecodeToonMaterialSlot. */
+	FORCEINLINE bool DecodeToonMaterialSlot(const FVector2D& Packed, int32& OutSlot)
+	{
+		const uint32 LowBits = (uint32)(Packed.X * 255.f + 0.5f);
+		const uint32 HighBits = (uint32)(Packed.Y * 255.f + 0.5f);
+		OutSlot = (int32)((HighBits << 7) | (LowBits >> 1));
+		return (LowBits & 1) != 0;
+	}
+
+	/**
+	 * Entry of ToonMaterialParametersTexture for the Toon material inputs, in the order CustomData0 (shadow intensity), CustomData1 (terminator
+	 * offset), SpecularOffset, SpecularRange. Saturated like the base pass does and already scaled like GetToonLightingContext does.
+	 */
+	FORCEINLINE FLinearColor MakeToonMaterialParameters(const FLinearColor& Inputs)
+	{
+		return FLinearColor(
+			Saturate(Inputs.R),
+			Saturate(Inputs.B) * 0.25f,
+			Saturate(Inputs.A) * 0.25f,
+			Saturate(Inputs.G) * 2.f - 1.f);
+	}
+
+	/** Quantizes a 0..1 value the way a unorm render target channel with NumBits bits stores it. */
+	FORCEINLINE float QuantizeUnorm(float X, int32 NumBits)
+	{
+		const float MaxValue = (float)((1 << NumBits) - 1);
+		return FMath::RoundToFloat(Saturate(X) * MaxValue) / MaxValue;
+	}
+
+	/*------------------------------------------------------------------------------
+		ShadingModels.ush
+	------------------------------------------------------------------------------*/
+
+	/** Mirrors FToonLightingContext: the per pixel toon parameters shared by every light. */
+	struct FToonLightingContext
+	{
+		float Offset;
+		float TerminatorRange;
+		float SpecularOffset;
+		float SpecularRange;
+		float SoftScatterStrength;
+		FVector ShadowColor;
+	};
+
+	/** Port of GetToonLightingContext. */
+	inline FToonLightingContext GetToonLightingContext(const FToonGBufferData& GBuffer)
+	{
+		FToonLightingContext ToonContext;
+		ToonContext.TerminatorRange = RoughnessToToonRange(GBuffer.Roughness);
+		ToonContext.SpecularOffset = 0.f;
+		ToonContext.SpecularRange = 0.f;
+		ToonContext.SoftScatterStrength = 0.f;
+		ToonContext.ShadowColor = FVector::ZeroVector;
+
+		float Offset = GBuffer.CustomData.W;
+
+		if (GBuffer.ShadingModelID == ShadingModelID_ToonSkin)
+		{
+			const FVector2D SSSMode = DecodeSSSModeSwitch(GBuffer.CustomData.W);
+			const FVector2D SParams = DecodeSpecRange(GBuffer.StoredMetallic);
+			Offset = SSSMode.X;
+			ToonContext.SoftScatterStrength = SSSMode.Y >= 0.3333f ? 0.f : 0.5f;
+
+			ToonContext.SpecularOffset = FMath::Pow(SParams.X, 4.f) * 0.25f;
+			ToonContext.SpecularRange = SParams.Y * 0.5f;
+
+			ToonContext.ShadowColor = FVector(GBuffer.CustomData.X, GBuffer.CustomData.Y, GBuffer.CustomData.Z);
+			ToonContext.ShadowColor *= ToonContext.ShadowColor;
+		}
+		else if (GBuffer.ShadingModelID == ShadingModelID_ToonAniso)
+		{
+			Offset = GBuffer.Metallic;
+		}
+		else
+		{
+			ToonContext.SpecularOffset = GBuffer.CustomData.Y * 0.25f;
+			ToonContext.SpecularRange = GBuffer.CustomData.Z * 0.25f;
+			ToonContext.ShadowColor = GBuffer.DiffuseColor * GBuffer.CustomData.X;
+		}
+
+		ToonContext.Offset = Offset * 2.f - 1.f;
+		return ToonContext;
+	}
+
+	/** Port of ToonDiffuseSpecular, the part ToonBxDF and ToonSkinBxDF share. FalloffColor is FAreaLight::FalloffColor. */
+	inline FToonDirectLighting ToonDiffuseSpecular(const FToonGBufferData& GBuffer, const FToonLightingContext& ToonContext, const FVector& N, const FVector& V, const FVector& L, float Falloff, const FVector& FalloffColor, float& OutNoH, float& OutNoLOffset)
+	{
+		const float TerminatorRange = ToonContext.TerminatorRange * 0.5f;
+
+		const FVector H = (V + L).GetUnsafeNormal();
+		OutNoH = Saturate(FVector::DotProduct(N, H));
+
+		const float NoL = (FVector::DotProduct(N, L) + 1.f) / 2.f;
+		OutNoLOffset = Saturate(NoL + ToonContext.Offset);
+
+		FToonDirectLighting Lighting;
+
+		Lighting.Diffuse = FalloffColor * (ToonStep(TerminatorRange, OutNoLOffset) * Falloff) * Diffuse_Lambert(GBuffer.DiffuseColor) * GetToonDiffuseBoost();
+
+		Lighting.Specular = ToonStep(ToonContext.SpecularRange, Saturate(D_GGX(ToonContext.SpecularOffset, OutNoH))) * (FalloffColor * GBuffer.SpecularColor * Falloff * 8.f);
+
+		Lighting.Transmission = FVector::ZeroVector;
+		return Lighting;
+	}
+
+	/** Scalar port of ToonBxDF (SHADINGMODELID_TOON). */
+	inline FToonDirectLighting ToonBxDF(const FToonGBufferData& GBuffer, const FToonLightingContext& ToonContext, const FVector& N, const FVector& V, const FVector& L, float Falloff, const FVector& FalloffColor)
+	{
+		float NoH;
+		float NoLOffset;
+		FToonDirectLighting Lighting = ToonDiffuseSpecular(GBuffer, ToonContext, N, V, L, Falloff, FalloffColor, NoH, NoLOffset);
+
+		const float TerminatorRange = ToonContext.TerminatorRange * 0.5f;
+		const FVector ShadowLightener = Saturate(ToonStep(TerminatorRange, Saturate(1.f - NoLOffset))) * ToonContext.ShadowColor * 0.1f;
+
+		Lighting.Transmission = ShadowLightener * Falloff;
+		return Lighting;
+	}
+
+	/** Scalar port of ToonSkinBxDF (SHADINGMODELID_TOON_SKIN). */
+	inline FToonDirectLighting ToonSkinBxDF(const FToonGBufferData& GBuffer, const FToonLightingContext& ToonContext, const FVector& N, const FVector& V, const FVector& L, float Falloff, const FVector& FalloffColor)
+	{
+		float NoH;
+		float NoLOffset;
+		FToonDirectLighting Lighting = ToonDiffuseSpecular(GBuffer, ToonContext, N, V, L, Falloff, FalloffColor, NoH, NoLOffset);
+
+		const FVector ShadowLightener = ToonContext.ShadowColor * 0.33f;
+		FVector TransmissionSoft = FVector::ZeroVector;
+		if (ToonContext.SoftScatterStrength > 0.f)
+		{
+			const float InScatter = FMath::Pow(Saturate(FVector::DotProduct(L, -V)), 12.f) * 0.1f;
+			const float BackScatter = GBuffer.GBufferAO * NoH / (PI * 2.f);
+
+			TransmissionSoft = FalloffColor * (Falloff * FMath::Lerp(BackScatter, 1.f, InScatter)) * ToonContext.ShadowColor * ToonContext.SoftScatterStrength;
+		}
+
+		Lighting.Transmission = (ShadowLightener + TransmissionSoft) * Falloff;
+		return Lighting;
+	}
+
+	/** Dispatches SHADINGMODELID_TOON and SHADINGMODELID_TOON_SKIN the same way IntegrateBxDF does. */
+	inline FToonDirectLighting IntegrateToonBxDF(const FToonGBufferData& GBuffer, const FVector& N, const FVector& V, const FVector& L, float Falloff, const FVector& FalloffColor)
+	{
+		const FToonLightingContext ToonContext = GetToonLightingContext(GBuffer);
+		if (GBuffer.ShadingModelID == ShadingModelID_ToonSkin)
+		{
+			return ToonSkinBxDF(GBuffer, ToonContext, N, V, L, Falloff, FalloffColor);
+		}
+		return ToonBxDF(GBuffer, ToonContext, N, V, L, Falloff, FalloffColor);
+	}
+
+	/** HLSL pow(X, 1.5) per component, X >= 0. */
+	FORCEINLINE FVector Pow1_5(const FVector& X)
+	{
+		return FVector(FMath::Pow(X.X, 1.5f), FMath::Pow(X.Y, 1.5f), FMath::Pow(X.Z, 1.5f));
+	}
+
+	FORCEINLINE FVector Sqrt(const FVector& X)
+	{
+		return FVector(FMath::Sqrt(X.X), FMath::Sqrt(X.Y), FMath::Sqrt(X.Z));
+	}
+
+	/** Secondary lobe tightness of ToonHairBxDF, lerp(SpecT_min, SpecT_max, SpecularTightness). */
+	FORCEINLINE float GetToonHairSpecularTightness(float CustomDataZ)
+	{
+		// Magic number discovered through experimentation
+		return CustomDataZ * 0.9975f;
+	}
+
+	/**
+	 * Scalar port of ToonHairBxDF. FalloffColor is FAreaLight::FalloffColor.
+	 *
+	 * The shader also decodes CustomData.x with OctahedronToUnitVector(DecodeUnitVectorFromFloat()), DecodeUnitVectorFromAngle() with
+	 * TOON_HAIR_ANGLE_TANGENT, and builds a Kajiya-Kay fake normal with a wrapped NoL, but none of these are read afterwards so the
+	 * shader compiler removes them. They are left out here, the toon shading benchmark still times them on their own.
+	 */
+	inline FToonDirectLighting ToonHairBxDF(const FToonGBufferData& GBuffer, const FVector& N, const FVector& V, const FVector& L, float Falloff, const FVector& FalloffColor)
+	{
+		const FVector H = (V + L).GetUnsafeNormal();
+		const float NoH = Saturate(FVector::DotProduct(N, H));
+		const float Roughness = Saturate(GBuffer.Roughness);
+
+		const FVector YVector = N;
+		const FVector XVector = FVector::CrossProduct(N, GBuffer.WorldNormal);
+
+		const float Offset = GBuffer.CustomData.W * 2.f - 1.f;
+		const float NoL = (FVector::DotProduct(N, L) + 1.f) / 2.f;
+
+		const float TerminatorRange = RoughnessToToonRange(Roughness) * 0.5f;
+
+		// Specular controls. pow(Metallic, 2) is folded into a multiply by the shader compiler
+		const float SpecularLobe2Strength = GBuffer.Metallic * GBuffer.Metallic;
+		const float SpecularTightness = GetToonHairSpecularTightness(GBuffer.CustomData.Z);
+		const float SpecTA = FMath::Lerp(2.f, 16.f, SpecularTightness);
+		const float SpecXBase = 1.5f - SpecularTightness;
+		const float SpecYBase = 1.f - SpecularTightness;
+
+		const float HA = Saturate(D_GGXaniso(Saturate(SpecXBase / SpecTA), Saturate(SpecYBase / SpecTA), NoH, H, XVector, YVector));
+		const float SpecularStep = ToonStep(Roughness, HA);
+		const FVector HB = SpecularStep * GBuffer.SpecularColor * 12.f;
+		const FVector HB2 = SpecularStep * GBuffer.BaseColor * 4.f;
+
+		FToonDirectLighting Lighting;
+		Lighting.Specular = FalloffColor * HB * Falloff;
+		const FVector SpecLobe2 = FalloffColor * HB2;
+		const FVector Specular2 = Pow1_5(SpecLobe2) * SpecularLobe2Strength;
+
+		// Soft Kajiya Kay diffuse attenuation
+		const float KajiyaDiffuse = ToonStep(TerminatorRange, 1.f - Saturate(NoL - Offset));
+
+		const float Luma = Luminance(GBuffer.BaseColor);
+		const float DiffuseScatter = (1.f / PI) * KajiyaDiffuse * GBuffer.CustomData.Y;
+		const FVector ScatterTint = GBuffer.BaseColor / Luma;
+		const FVector Scatter = Sqrt(GBuffer.BaseColor) * DiffuseScatter * ScatterTint;
+
+		// Shadow lightening, driven by scatter
+		const FVector ShadowColor = GBuffer.CustomData.Y * 0.5f * GBuffer.DiffuseColor * (1.f - KajiyaDiffuse);
+
+		const FVector HairDiffuse = (Specular2 + Scatter + ShadowColor) * Falloff;
+		const float TransAtMaxScatter = 0.5f;
+		Lighting.Transmission = HairDiffuse * FMath::Lerp(0.f, TransAtMaxScatter, GBuffer.CustomData.Y);
+		Lighting.Diffuse = HairDiffuse * FMath::Lerp(1.f, 1.f - TransAtMaxScatter, GBuffer.CustomData.Y);
+		return Lighting;
+	}
+
+	/** Port of IsToonAnisoIsotropic as the deferred passes compile it, testing the stored anisotropy. */
+	FORCEINLINE bool IsToonAnisoIsotropic(float EncodedAnisotropy)
+	{
+		return FMath::Abs(EncodedAnisotropy * 255.f - 128.f) < 0.5f;
+	}
+
+	/** Port of ConvertAnisotropyToRoughness from ShadingModels.ush. */
+	FORCEINLINE void ConvertAnisotropyToRoughness(float Roughness, float Anisotropy, float& OutRoughnessT, float& OutRoughnessB)
+	{
+		const float AnisoAspect = FMath::Sqrt(1.f - 0.9f * Anisotropy);
+		OutRoughnessT = Roughness / AnisoAspect;
+		OutRoughnessB = Roughness * AnisoAspect;
+	}
+
+	/** Scalar port of ToonAnisoShading (SHADINGMODELID_TOON_ANISO). FalloffColor is FAreaLight::FalloffColor. */
+	inline FToonDirectLighting ToonAnisoBxDF(const FToonGBufferData& GBuffer, const FToonLightingContext& ToonContext, const FVector& N, const FVector& V, const FVector& L, float Falloff, const FVector& FalloffColor)
+	{
+		const FVector H = (L + V).GetUnsafeNormal();
+		const float NoH = Saturate(FVector::DotProduct(N, H));
+
+		const float TerminatorRange = ToonContext.TerminatorRange * 0.5f;
+
+		const float NoL = (FVector::DotProduct(N, L) + 1.f) / 2.f;
+		const float NoLOffset = Saturate(NoL + ToonContext.Offset);
+
+		float D = 0.f;
+		const float AnisotropyRoughness = GBuffer.CustomData.Z;
+		if (IsToonAnisoIsotropic(GBuffer.CustomData.W))
+		{
+			D = D_GGX(FMath::Max(1e-5f, AnisotropyRoughness), NoH);
+		}
+		else
+		{
+			FVector T = OctahedronToUnitVector(FVector2D(GBuffer.CustomData.X, GBuffer.CustomData.Y) * 2.f - 1.f);
+			const FVector B = FVector::CrossProduct(T, GBuffer.WorldNormal).GetUnsafeNormal();
+			T = FVector::CrossProduct(GBuffer.WorldNormal, B);
+			if (FVector::DotProduct(FVector::CrossProduct(T, GBuffer.WorldNormal), B) < 0.f)
+			{
+				T *= -1.f;
+			}
+
+			const float Anisotropy = GBuffer.CustomData.W * 2.f - 1.f;
+			float RoughnessX;
+			float RoughnessY;
+			ConvertAnisotropyToRoughness(AnisotropyRoughness, FMath::Abs(Anisotropy), RoughnessX, RoughnessY);
+			RoughnessX = FMath::Max(1e-5f, RoughnessX);
+			RoughnessY = FMath::Max(1e-5f, RoughnessY);
+
+			D = Anisotropy >= 0.f
+				? D_GGXaniso(FMath::Sqrt(RoughnessX), FMath::Sqrt(RoughnessY), NoH, H, T, B)
+				: D_GGXaniso(FMath::Sqrt(RoughnessY), FMath::Sqrt(RoughnessX), NoH, H, T, B);
+		}
+
+		FToonDirectLighting Lighting;
+		Lighting.Diffuse = FalloffColor * (ToonStep(TerminatorRange, NoLOffset) * Falloff) * Diffuse_Lambert(GBuffer.DiffuseColor) * GetToonDiffuseBoost();
+
+		const float DVF = ToonStep(TerminatorRange, D) * 0.5f;
+		Lighting.Specular = FalloffColor * (DVF * GBuffer.Specular * 2.f * Falloff);
+		Lighting.Transmission = FVector::ZeroVector;
+		return Lighting;
+	}
+
+	/**
+	 * Structure of arrays batch of toon samples. Every array must hold Num() elements.
+	 * Samples are independent; each one carries its own GBuffer data and N/V/L.
+	 */
+	struct FToonShadingBatch
+	{
+		TArray<float> NormalX, NormalY, NormalZ;
+		TArray<float> ViewX, ViewY, ViewZ;
+		TArray<float> LightX, LightY, LightZ;
+		TArray<float> Falloff;
+		TArray<float> DiffuseColorR, DiffuseColorG, DiffuseColorB;
+		TArray<float> SpecularColorR, SpecularColorG, SpecularColorB;
+		TArray<float> Roughness;
+		TArray<float> StoredMetallic;
+		TArray<float> GBufferAO;
+		TArray<float> CustomDataX, CustomDataY, CustomDataZ, CustomDataW;
+		/** SHADINGMODELID_TOON or SHADINGMODELID_TOON_SKIN */
+		TArray<uint32> ShadingModelID;
+
+		int32 Num() const { return Falloff.Num(); }
+
+		void SetNumUninitialized(int32 InNum)
+		{
+			for (TArray<float>* Stream : GetFloatStreams())
+			{
+				Stream->SetNumUninitialized(InNum);
+			}
+			ShadingModelID.SetNumUninitialized(InNum);
+		}
+
+		/** Writes sample Index from AoS data. */
+		void SetSample(int32 Index, const FToonGBufferData& GBuffer, const FVector& N, const FVector& V, const FVector& L, float InFalloff)
+		{
+			NormalX[Index] = N.X; NormalY[Index] = N.Y; NormalZ[Index] = N.Z;
+			ViewX[Index] = V.X; ViewY[Index] = V.Y; ViewZ[Index] = V.Z;
+			LightX[Index] = L.X; LightY[Index] = L.Y; LightZ[Index] = L.Z;
+			Falloff[Index] = InFalloff;
+			DiffuseColorR[Index] = GBuffer.DiffuseColor.X; DiffuseColorG[Index] = GBuffer.DiffuseColor.Y; DiffuseColorB[Index] = GBuffer.DiffuseColor.Z;
+			SpecularColorR[Index] = GBuffer.SpecularColor.X; SpecularColorG[Index] = GBuffer.SpecularColor.Y; SpecularColorB[Index] = GBuffer.SpecularColor.Z;
+			Roughness[Index] = GBuffer.Roughness;
+			StoredMetallic[Index] = GBuffer.StoredMetallic;
+			GBufferAO[Index] = GBuffer.GBufferAO;
+			CustomDataX[Index] = GBuffer.CustomData.X; CustomDataY[Index] = GBuffer.CustomData.Y; CustomDataZ[Index] = GBuffer.CustomData.Z; CustomDataW[Index] = GBuffer.CustomData.W;
+			ShadingModelID[Index] = GBuffer.ShadingModelID;
+		}
+
+		/** Reads sample Index back as AoS data, e.g. to run it through the scalar reference. */
+		void GetSample(int32 Index, FToonGBufferData& OutGBuffer, FVector& OutN, FVector& OutV, FVector& OutL, float& OutFalloff) const
+		{
+			OutGBuffer = FToonGBufferData();
+			OutN = FVector(NormalX[Index], NormalY[Index], NormalZ[Index]);
+			OutV = FVector(ViewX[Index], ViewY[Index], ViewZ[Index]);
+			OutL = FVector(LightX[Index], LightY[Index], LightZ[Index]);
+			OutFalloff = Falloff[Index];
+			OutGBuffer.WorldNormal = OutN;
+			OutGBuffer.DiffuseColor = FVector(DiffuseColorR[Index], DiffuseColorG[Index], DiffuseColorB[Index]);
+			OutGBuffer.SpecularColor = FVector(SpecularColorR[Index], SpecularColorG[Index], SpecularColorB[Index]);
+			OutGBuffer.Roughness = Roughness[Index];
+			OutGBuffer.StoredMetallic = StoredMetallic[Index];
+			OutGBuffer.GBufferAO = GBufferAO[Index];
+			OutGBuffer.CustomData = FVector4(CustomDataX[Index], CustomDataY[Index], CustomDataZ[Index], CustomDataW[Index]);
+			OutGBuffer.ShadingModelID = ShadingModelID[Index];
+		}
+
+	private:
+		TArray<TArray<float>*, TInlineAllocator<23>> GetFloatStreams()
+		{
+			return {
+				&NormalX, &NormalY, &NormalZ, &ViewX, &ViewY, &ViewZ, &LightX, &LightY, &LightZ, &Falloff,
+				&DiffuseColorR, &DiffuseColorG, &DiffuseColorB, &SpecularColorR, &SpecularColorG, &SpecularColorB,
+				&Roughness, &StoredMetallic, &GBufferAO, &CustomDataX, &CustomDataY, &CustomDataZ, &CustomDataW };
+		}
+	};
+
+	/** Structure of arrays output of EvaluateToonBxDFBatch. */
+	struct FToonDirectLightingBatch
+	{
+		TArray<float> DiffuseR, DiffuseG, DiffuseB;
+		TArray<float> SpecularR, SpecularG, SpecularB;
+		TArray<float> TransmissionR, TransmissionG, TransmissionB;
+
+		void SetNumUninitialized(int32 InNum)
+		{
+			for (TArray<float>* Stream : { &DiffuseR, &DiffuseG, &DiffuseB, &SpecularR, &SpecularG, &SpecularB, &TransmissionR, &TransmissionG, &TransmissionB })
+			{
+				Stream->SetNumUninitialized(InNum);
+			}
+		}
+
+		void SetSample(int32 Index, const FToonDirectLighting& Lighting)
+		{
+			DiffuseR[Index] = Lighting.Diffuse.X; DiffuseG[Index] = Lighting.Diffuse.Y; DiffuseB[Index] = Lighting.Diffuse.Z;
+			SpecularR[Index] = Lighting.Specular.X; SpecularG[Index] = Lighting.Specular.Y; SpecularB[Index] = Lighting.Specular.Z;
+			TransmissionR[Index] = Lighting.Transmission.X; TransmissionG[Index] = Lighting.Transmission.Y; TransmissionB[Index] = Lighting.Transmission.Z;
+		}
+
+		FToonDirectLighting GetSample(int32 Index) const
+		{
+			FToonDirectLighting Lighting;
+			Lighting.Diffuse = FVector(DiffuseR[Index], DiffuseG[Index], DiffuseB[Index]);
+			Lighting.Specular = FVector(SpecularR[Index], SpecularG[Index], SpecularB[Index]);
+			Lighting.Transmission = FVector(TransmissionR[Index], TransmissionG[Index], TransmissionB[Index]);
+			return Lighting;
+		}
+	};
+
+	namespace VectorMath
+	{
+		FORCEINLINE VectorRegister Saturate(const VectorRegister& X)
+		{
+			// max/min return the second operand for NaN inputs, which keeps the GPU NaN -> 0 behavior
+			return VectorMin(VectorMax(X, VectorZero()), VectorOne());
+		}
+
+		FORCEINLINE VectorRegister SmoothStep(const VectorRegister& Min, const VectorRegister& Max, const VectorRegister& X)
+		{
+			const VectorRegister T = Saturate(VectorDivide(VectorSubtract(X, Min), VectorSubtract(Max, Min)));
+			return VectorMultiply(VectorMultiply(T, T), VectorSubtract(VectorSetFloat1(3.f), VectorAdd(T, T)));
+		}
+
+		FORCEINLINE VectorRegister ToonStep(const VectorRegister& Range, const VectorRegister& Input)
+		{
+			const VectorRegister Half = VectorSetFloat1(0.5f);
+			return SmoothStep(VectorSubtract(Half, Range), VectorAdd(Half, Range), Input);
+		}
+
+		FORCEINLINE VectorRegister Dot3(const VectorRegister& AX, const VectorRegister& AY, const VectorRegister& AZ, const VectorRegister& BX, const VectorRegister& BY, const VectorRegister& BZ)
+		{
+			return VectorMultiplyAdd(AX, BX, VectorMultiplyAdd(AY, BY, VectorMultiply(AZ, BZ)));
+		}
+
+		FORCEINLINE VectorRegister D_GGX(const VectorRegister& a2, const VectorRegister& NoH)
+		{
+			const VectorRegister d = VectorMultiplyAdd(VectorSubtract(VectorMultiply(NoH, a2), NoH), NoH, VectorOne());
+			return VectorDivide(a2, VectorMultiply(VectorSetFloat1(PI), VectorMultiply(d, d)));
+		}
+	}
+
+	/**
+	 * Evaluates IntegrateToonBxDF for every sample of the batch, four lanes at a time using the VectorRegister abstraction.
+	 * Results match the scalar reference up to the precision of rsqrt/pow, see the tolerances used by the toon shading benchmark.
+	 */
+	inline void EvaluateToonBxDFBatch(const FToonShadingBatch& Batch, const FVector& FalloffColor, FToonDirectLightingBatch& OutLighting)
+	{
+		using namespace VectorMath;
+
+		const int32 NumSamples = Batch.Num();
+		OutLighting.SetNumUninitialized(NumSamples);
+
+		const VectorRegister Zero = VectorZero();
+		const VectorRegister One = VectorOne();
+		const VectorRegister Half = VectorSetFloat1(0.5f);
+		const VectorRegister Two = VectorSetFloat1(2.f);
+		const VectorRegister FalloffColorR = VectorSetFloat1(FalloffColor.X);
+		const VectorRegister FalloffColorG = VectorSetFloat1(FalloffColor.Y);
+		const VectorRegister FalloffColorB = VectorSetFloat1(FalloffColor.Z);
+		const VectorRegister DiffuseScale = VectorSetFloat1(GetToonDiffuseBoost() / PI);
+
+		const int32 NumVectorSamples = NumSamples & ~3;
+		for (int32 Index = 0; Index < NumVectorSamples; Index += 4)
+		{
+			const VectorRegister NX = VectorLoad(&Batch.NormalX[Index]);
+			const VectorRegister NY = VectorLoad(&Batch.NormalY[Index]);
+			const VectorRegister NZ = VectorLoad(&Batch.NormalZ[Index]);
+			const VectorRegister VX = VectorLoad(&Batch.ViewX[Index]);
+			const VectorRegister VY = VectorLoad(&Batch.ViewY[Index]);
+			const VectorRegister VZ = VectorLoad(&Batch.ViewZ[Index]);
+			const VectorRegister LX = VectorLoad(&Batch.LightX[Index]);
+			const VectorRegister LY = VectorLoad(&Batch.LightY[Index]);
+			const VectorRegister LZ = VectorLoad(&Batch.LightZ[Index]);
+			const VectorRegister Falloff = VectorLoad(&Batch.Falloff[Index]);
+			const VectorRegister DiffuseR = VectorLoad(&Batch.DiffuseColorR[Index]);
+			const VectorRegister DiffuseG = VectorLoad(&Batch.DiffuseColorG[Index]);
+			const VectorRegister DiffuseB = VectorLoad(&Batch.DiffuseColorB[Index]);
+			const VectorRegister CustomX = VectorLoad(&Batch.CustomDataX[Index]);
+			const VectorRegister CustomY = VectorLoad(&Batch.CustomDataY[Index]);
+			const VectorRegister CustomZ = VectorLoad(&Batch.CustomDataZ[Index]);
+			const VectorRegister CustomW = VectorLoad(&Batch.CustomDataW[Index]);
+
+			const VectorRegister IsSkin = MakeVectorRegister(
+				Batch.ShadingModelID[Index + 0] == ShadingModelID_ToonSkin ? 0xFFFFFFFFu : 0u,
+				Batch.ShadingModelID[Index + 1] == ShadingModelID_ToonSkin ? 0xFFFFFFFFu : 0u,
+				Batch.ShadingModelID[Index + 2] == ShadingModelID_ToonSkin ? 0xFFFFFFFFu : 0u,
+				Batch.ShadingModelID[Index + 3] == ShadingModelID_ToonSkin ? 0xFFFFFFFFu : 0u);
+
+			const VectorRegister TerminatorRange = VectorMultiply(Saturate(VectorSubtract(VectorLoad(&Batch.Roughness[Index]), Half)), Half);
+
+			// Skin stores specular offset/range in Metallic and the SSS mode in CustomData.w
+			const VectorRegister StoredMetallic = VectorLoad(&Batch.StoredMetallic[Index]);
+			const VectorRegister SpecHY = VectorMultiply(VectorMod(VectorFloor(VectorMultiply(StoredMetallic, VectorSetFloat1(8.f))), VectorSetFloat1(8.f)), VectorSetFloat1(0.125f));
+			const VectorRegister SpecHX = VectorSubtract(VectorMultiply(VectorMultiply(VectorSubtract(StoredMetallic, SpecHY), VectorSetFloat1(8.f)), VectorSetFloat1(1.f / 0.98f)), VectorSetFloat1(0.01f));
+			const VectorRegister SpecHX2 = VectorMultiply(SpecHX, SpecHX);
+			const VectorRegister SkinSpecularOffset = VectorMultiply(VectorMultiply(SpecHX2, SpecHX2), VectorSetFloat1(0.25f));
+			const VectorRegister SkinSpecularRange = VectorMultiply(SpecHY, Half);
+
+			const VectorRegister SSSInput = VectorMultiply(CustomW, VectorSetFloat1(1.5f));
+			const VectorRegister SSSHY = VectorMultiply(VectorMod(VectorFloor(VectorMultiply(SSSInput, Two)), Two), Half);
+			const VectorRegister SSSHX = VectorMultiply(VectorSubtract(SSSInput, SSSHY), VectorSetFloat1(2.1f));
+			const VectorRegister SkinSoftScatter = VectorSelect(VectorCompareGE(SSSHY, VectorSetFloat1(0.3333f)), Zero, Half);
+
+			// GetToonLightingContext: CustomData.yz * 0.25 for toon
+			const VectorRegister ToonSpecularOffset = VectorMultiply(CustomY, VectorSetFloat1(0.25f));
+			const VectorRegister ToonSpecularRange = VectorMultiply(CustomZ, VectorSetFloat1(0.25f));
+
+			const VectorRegister SpecularOffset = VectorSelect(IsSkin, SkinSpecularOffset, ToonSpecularOffset);
+			const VectorRegister SpecularRange = VectorSelect(IsSkin, SkinSpecularRange, ToonSpecularRange);
+			const VectorRegister SoftScatterStrength = VectorSelect(IsSkin, SkinSoftScatter, Zero);
+			const VectorRegister Offset = VectorSubtract(VectorMultiply(VectorSelect(IsSkin, SSSHX, CustomW), Two), One);
+
+			const VectorRegister ShadowR = VectorSelect(IsSkin, VectorMultiply(CustomX, CustomX), VectorMultiply(DiffuseR, CustomX));
+			const VectorRegister ShadowG = VectorSelect(IsSkin, VectorMultiply(CustomY, CustomY), VectorMultiply(DiffuseG, CustomX));
+			const VectorRegister ShadowB = VectorSelect(IsSkin, VectorMultiply(CustomZ, CustomZ), VectorMultiply(DiffuseB, CustomX));
+
+			VectorRegister HX = VectorAdd(VX, LX);
+			VectorRegister HY = VectorAdd(VY, LY);
+			VectorRegister HZ = VectorAdd(VZ, LZ);
+			const VectorRegister InvHLength = VectorReciprocalSqrtAccurate(Dot3(HX, HY, HZ, HX, HY, HZ));
+			HX = VectorMultiply(HX, InvHLength);
+			HY = VectorMultiply(HY, InvHLength);
+			HZ = VectorMultiply(HZ, InvHLength);
+			const VectorRegister NoH = Saturate(Dot3(NX, NY, NZ, HX, HY, HZ));
+
+			const VectorRegister NoL = VectorMultiply(VectorAdd(Dot3(NX, NY, NZ, LX, LY, LZ), One), Half);
+			const VectorRegister NoLOffset = Saturate(VectorAdd(NoL, Offset));
+
+			const VectorRegister DiffuseTerm = VectorMultiply(VectorMultiply(ToonStep(TerminatorRange, NoLOffset), Falloff), DiffuseScale);
+			VectorStore(VectorMultiply(VectorMultiply(FalloffColorR, DiffuseTerm), DiffuseR), &OutLighting.DiffuseR[Index]);
+			VectorStore(VectorMultiply(VectorMultiply(FalloffColorG, DiffuseTerm), DiffuseG), &OutLighting.DiffuseG[Index]);
+			VectorStore(VectorMultiply(VectorMultiply(FalloffColorB, DiffuseTerm), DiffuseB), &OutLighting.DiffuseB[Index]);
+
+			const VectorRegister SpecularTerm = VectorMultiply(VectorMultiply(ToonStep(SpecularRange, Saturate(D_GGX(SpecularOffset, NoH))), Falloff), VectorSetFloat1(8.f));
+			VectorStore(VectorMultiply(VectorMultiply(FalloffColorR, SpecularTerm), VectorLoad(&Batch.SpecularColorR[Index])), &OutLighting.SpecularR[Index]);
+			VectorStore(VectorMultiply(VectorMultiply(FalloffColorG, SpecularTerm), VectorLoad(&Batch.SpecularColorG[Index])), &OutLighting.SpecularG[Index]);
+			VectorStore(VectorMultiply(VectorMultiply(FalloffColorB, SpecularTerm), VectorLoad(&Batch.SpecularColorB[Index])), &OutLighting.SpecularB[Index]);
+
+			// pow(saturate(dot(L, -V)), 12)
+			const VectorRegister LoNegV = Saturate(VectorNegate(Dot3(LX, LY, LZ, VX, VY, VZ)));
+			const VectorRegister LoNegV2 = VectorMultiply(LoNegV, LoNegV);
+			const VectorRegister LoNegV4 = VectorMultiply(LoNegV2, LoNegV2);
+			const VectorRegister InScatter = VectorMultiply(VectorMultiply(VectorMultiply(LoNegV4, LoNegV4), LoNegV4), VectorSetFloat1(0.1f));
+			const VectorRegister BackScatter = VectorMultiply(VectorMultiply(VectorLoad(&Batch.GBufferAO[Index]), NoH), VectorSetFloat1(1.f / (PI * 2.f)));
+			const VectorRegister ScatterLerp = VectorMultiplyAdd(VectorSubtract(One, BackScatter), InScatter, BackScatter);
+			const VectorRegister TransmissionSoft = VectorMultiply(VectorMultiply(Falloff, ScatterLerp), SoftScatterStrength);
+
+			const VectorRegister Lightener = VectorSelect(IsSkin, VectorSetFloat1(0.33f),
+				VectorMultiply(Saturate(ToonStep(TerminatorRange, Saturate(VectorSubtract(One, NoLOffset)))), VectorSetFloat1(0.1f)));
+
+			VectorStore(VectorMultiply(VectorMultiply(ShadowR, VectorMultiplyAdd(FalloffColorR, TransmissionSoft, Lightener)), Falloff), &OutLighting.TransmissionR[Index]);
+			VectorStore(VectorMultiply(VectorMultiply(ShadowG, VectorMultiplyAdd(FalloffColorG, TransmissionSoft, Lightener)), Falloff), &OutLighting.TransmissionG[Index]);
+			VectorStore(VectorMultiply(VectorMultiply(ShadowB, VectorMultiplyAdd(FalloffColorB, TransmissionSoft, Lightener)), Falloff), &OutLighting.TransmissionB[Index]);
+		}
+
+		// Remaining samples go through the scalar reference
+		for (int32 Index = NumVectorSamples; Index < NumSamples; ++Index)
+		{
+			FToonGBufferData GBuffer;
+			FVector N, V, L;
+			float Falloff;
+			Batch.GetSample(Index, GBuffer, N, V, L, Falloff);
+			OutLighting.SetSample(Index, IntegrateToonBxDF(GBuffer, N, V, L, Falloff, FalloffColor));
+		}
+	}
+
+	/** Structure of arrays batch of ToonHair samples, see FToonShadingBatch. */
+	struct FToonHairShadingBatch
+	{
+		TArray<float> NormalX, NormalY, NormalZ;
+		TArray<float> ViewX, ViewY, ViewZ;
+		TArray<float> LightX, LightY, LightZ;
+		TArray<float> Falloff;
+		/** GBuffer.WorldNormal. The deferred light pass passes it as N as well, which zeroes the anisotropic X direction. */
+		TArray<float> WorldNormalX, WorldNormalY, WorldNormalZ;
+		TArray<float> BaseColorR, BaseColorG, BaseColorB;
+		TArray<float> DiffuseColorR, DiffuseColorG, DiffuseColorB;
+		TArray<float> SpecularColorR, SpecularColorG, SpecularColorB;
+		TArray<float> Roughness;
+		TArray<float> Metallic;
+		/** CustomData.x only holds the normal ToonHairBxDF never reads */
+		TArray<float> CustomDataY, CustomDataZ, CustomDataW;
+
+		int32 Num() const { return Falloff.Num(); }
+
+		void SetNumUninitialized(int32 InNum)
+		{
+			for (TArray<float>* Stream : GetFloatStreams())
+			{
+				Stream->SetNumUninitialized(InNum);
+			}
+		}
+
+		void SetSample(int32 Index, const FToonGBufferData& GBuffer, const FVector& N, const FVector& V, const FVector& L, float InFalloff)
+		{
+			NormalX[Index] = N.X; NormalY[Index] = N.Y; NormalZ[Index] = N.Z;
+			ViewX[Index] = V.X; ViewY[Index] = V.Y; ViewZ[Index] = V.Z;
+			LightX[Index] = L.X; LightY[Index] = L.Y; LightZ[Index] = L.Z;
+			Falloff[Index] = InFalloff;
+			WorldNormalX[Index] = GBuffer.WorldNormal.X; WorldNormalY[Index] = GBuffer.WorldNormal.Y; WorldNormalZ[Index] = GBuffer.WorldNormal.Z;
+			BaseColorR[Index] = GBuffer.BaseColor.X; BaseColorG[Index] = GBuffer.BaseColor.Y; BaseColorB[Index] = GBuffer.BaseColor.Z;
+			DiffuseColorR[Index] = GBuffer.DiffuseColor.X; DiffuseColorG[Index] = GBuffer.DiffuseColor.Y; DiffuseColorB[Index] = GBuffer.DiffuseColor.Z;
+			SpecularColorR[Index] = GBuffer.SpecularColor.X; SpecularColorG[Index] = GBuffer.SpecularColor.Y; SpecularColorB[Index] = GBuffer.SpecularColor.Z;
+			Roughness[Index] = GBuffer.Roughness;
+			Metallic[Index] = GBuffer.Metallic;
+			CustomDataY[Index] = GBuffer.CustomData.Y; CustomDataZ[Index] = GBuffer.CustomData.Z; CustomDataW[Index] = GBuffer.CustomData.W;
+		}
+
+		void GetSample(int32 Index, FToonGBufferData& OutGBuffer, FVector& OutN, FVector& OutV, FVector& OutL, float& OutFalloff) const
+		{
+			OutGBuffer = FToonGBufferData();
+			OutN = FVector(NormalX[Index], NormalY[Index], NormalZ[Index]);
+			OutV = FVector(ViewX[Index], ViewY[Index], ViewZ[Index]);
+			OutL = FVector(LightX[Index], LightY[Index], LightZ[Index]);
+			OutFalloff = Falloff[Index];
+			OutGBuffer.WorldNormal = FVector(WorldNormalX[Index], WorldNormalY[Index], WorldNormalZ[Index]);
+			OutGBuffer.BaseColor = FVector(BaseColorR[Index], BaseColorG[Index], BaseColorB[Index]);
+			OutGBuffer.DiffuseColor = FVector(DiffuseColorR[Index], DiffuseColorG[Index], DiffuseColorB[Index]);
+			OutGBuffer.SpecularColor = FVector(SpecularColorR[Index], SpecularColorG[Index], SpecularColorB[Index]);
+			OutGBuffer.Roughness = Roughness[Index];
+			OutGBuffer.Metallic = Metallic[Index];
+			OutGBuffer.CustomData = FVector4(0.f, CustomDataY[Index], CustomDataZ[Index], CustomDataW[Index]);
+			OutGBuffer.ShadingModelID = ShadingModelID_ToonHair;
+		}
+
+	private:
+		TArray<TArray<float>*, TInlineAllocator<27>> GetFloatStreams()
+		{
+			return {
+				&NormalX, &NormalY, &NormalZ, &ViewX, &ViewY, &ViewZ, &LightX, &LightY, &LightZ, &Falloff,
+				&WorldNormalX, &WorldNormalY, &WorldNormalZ, &BaseColorR, &BaseColorG, &BaseColorB,
+				&DiffuseColorR, &DiffuseColorG, &DiffuseColorB, &SpecularColorR, &SpecularColorG, &SpecularColorB,
+				&Roughness, &Metallic, &CustomDataY, &CustomDataZ, &CustomDataW };
+		}
+	};
+
+	namespace VectorMath
+	{
+		/** sqrt(X) for X >= 0, 0 where X is 0 instead of the NaN of X * rsqrt(X). */
+		FORCEINLINE VectorRegister SqrtNonNegative(const VectorRegister& X)
+		{
+			return VectorSelect(VectorCompareGT(X, VectorZero()), VectorMultiply(X, VectorReciprocalSqrtAccurate(X)), VectorZero());
+		}
+
+		FORCEINLINE VectorRegister D_GGXaniso(const VectorRegister& ax, const VectorRegister& ay, const VectorRegister& NoH, const VectorRegister& XoH, const VectorRegister& YoH)
+		{
+			const VectorRegister d = VectorAdd(
+				VectorAdd(VectorDivide(VectorMultiply(XoH, XoH), VectorMultiply(ax, ax)), VectorDivide(VectorMultiply(YoH, YoH), VectorMultiply(ay, ay))),
+				VectorMultiply(NoH, NoH));
+			return VectorReciprocalAccurate(VectorMultiply(VectorMultiply(VectorSetFloat1(PI), VectorMultiply(ax, ay)), VectorMultiply(d, d)));
+		}
+	}
+
+	/**
+	 * Evaluates ToonHairBxDF for every sample of the batch, four lanes at a time using the VectorRegister abstraction.
+	 * pow(x, 1.5) is evaluated as x * sqrt(x), so results match the scalar reference up to the precision of rsqrt, see the
+	 * tolerances used by the toon shading benchmark.
+	 */
+	inline void EvaluateToonHairBxDFBatch(const FToonHairShadingBatch& Batch, const FVector& FalloffColor, FToonDirectLightingBatch& OutLighting)
+	{
+		using namespace VectorMath;
+
+		const int32 NumSamples = Batch.Num();
+		OutLighting.SetNumUninitialized(NumSamples);
+
+		const VectorRegister One = VectorOne();
+		const VectorRegister Half = VectorSetFloat1(0.5f);
+		const VectorRegister FalloffColorR = VectorSetFloat1(FalloffColor.X);
+		const VectorRegister FalloffColorG = VectorSetFloat1(FalloffColor.Y);
+		const VectorRegister FalloffColorB = VectorSetFloat1(FalloffColor.Z);
+
+		const int32 NumVectorSamples = NumSamples & ~3;
+		for (int32 Index = 0; Index < NumVectorSamples; Index += 4)
+		{
+			const VectorRegister NX = VectorLoad(&Batch.NormalX[Index]);
+			const VectorRegister NY = VectorLoad(&Batch.NormalY[Index]);
+			const VectorRegister NZ = VectorLoad(&Batch.NormalZ[Index]);
+			const VectorRegister VX = VectorLoad(&Batch.ViewX[Index]);
+			const VectorRegister VY = VectorLoad(&Batch.ViewY[Index]);
+			const VectorRegister VZ = VectorLoad(&Batch.ViewZ[Index]);
+			const VectorRegister LX = VectorLoad(&Batch.LightX[Index]);
+			const VectorRegister LY = VectorLoad(&Batch.LightY[Index]);
+			const VectorRegister LZ = VectorLoad(&Batch.LightZ[Index]);
+			const VectorRegister WX = VectorLoad(&Batch.WorldNormalX[Index]);
+			const VectorRegister WY = VectorLoad(&Batch.WorldNormalY[Index]);
+			const VectorRegister WZ = VectorLoad(&Batch.WorldNormalZ[Index]);
+			const VectorRegister Falloff = VectorLoad(&Batch.Falloff[Index]);
+			const VectorRegister BaseR = VectorLoad(&Batch.BaseColorR[Index]);
+			const VectorRegister BaseG = VectorLoad(&Batch.BaseColorG[Index]);
+			const VectorRegister BaseB = VectorLoad(&Batch.BaseColorB[Index]);
+			const VectorRegister Metallic = VectorLoad(&Batch.Metallic[Index]);
+			const VectorRegister Scatter = VectorLoad(&Batch.CustomDataY[Index]);
+			const VectorRegister Roughness = Saturate(VectorLoad(&Batch.Roughness[Index]));
+
+			VectorRegister HX = VectorAdd(VX, LX);
+			VectorRegister HY = VectorAdd(VY, LY);
+			VectorRegister HZ = VectorAdd(VZ, LZ);
+			const VectorRegister InvHLength = VectorReciprocalSqrtAccurate(Dot3(HX, HY, HZ, HX, HY, HZ));
+			HX = VectorMultiply(HX, InvHLength);
+			HY = VectorMultiply(HY, InvHLength);
+			HZ = VectorMultiply(HZ, InvHLength);
+			const VectorRegister YoH = Dot3(NX, NY, NZ, HX, HY, HZ);
+			const VectorRegister NoH = Saturate(YoH);
+
+			// XVector = cross(N, GBuffer.WorldNormal)
+			const VectorRegister XX = VectorSubtract(VectorMultiply(NY, WZ), VectorMultiply(NZ, WY));
+			const VectorRegister XY = VectorSubtract(VectorMultiply(NZ, WX), VectorMultiply(NX, WZ));
+			const VectorRegister XZ = VectorSubtract(VectorMultiply(NX, WY), VectorMultiply(NY, WX));
+			const VectorRegister XoH = Dot3(XX, XY, XZ, HX, HY, HZ);
+
+			const VectorRegister Offset = VectorSubtract(VectorAdd(VectorLoad(&Batch.CustomDataW[Index]), VectorLoad(&Batch.CustomDataW[Index])), One);
+			const VectorRegister NoL = VectorMultiply(VectorAdd(Dot3(NX, NY, NZ, LX, LY, LZ), One), Half);
+			const VectorRegister TerminatorRange = VectorMultiply(Saturate(VectorSubtract(Roughness, Half)), Half);
+
+			const VectorRegister SpecularTightness = VectorMultiply(VectorLoad(&Batch.CustomDataZ[Index]), VectorSetFloat1(0.9975f));
+			const VectorRegister SpecTA = VectorMultiplyAdd(SpecularTightness, VectorSetFloat1(16.f - 2.f), VectorSetFloat1(2.f));
+			const VectorRegister InvSpecTA = VectorReciprocalAccurate(SpecTA);
+			const VectorRegister ax = Saturate(VectorMultiply(VectorSubtract(VectorSetFloat1(1.5f), SpecularTightness), InvSpecTA));
+			const VectorRegister ay = Saturate(VectorMultiply(VectorSubtract(One, SpecularTightness), InvSpecTA));
+
+			const VectorRegister SpecularStep = ToonStep(Roughness, Saturate(D_GGXaniso(ax, ay, NoH, XoH, YoH)));
+
+			const VectorRegister SpecularTerm = VectorMultiply(VectorMultiply(SpecularStep, VectorSetFloat1(12.f)), Falloff);
+			VectorStore(VectorMultiply(VectorMultiply(FalloffColorR, SpecularTerm), VectorLoad(&Batch.SpecularColorR[Index])), &OutLighting.SpecularR[Index]);
+			VectorStore(VectorMultiply(VectorMultiply(FalloffColorG, SpecularTerm), VectorLoad(&Batch.SpecularColorG[Index])), &OutLighting.SpecularG[Index]);
+			VectorStore(VectorMultiply(VectorMultiply(FalloffColorB, SpecularTerm), VectorLoad(&Batch.SpecularColorB[Index])), &OutLighting.SpecularB[Index]);
+
+			// pow(SpecLobe2, 1.5) * pow(Metallic, 2)
+			const VectorRegister Lobe2Term = VectorMultiply(SpecularStep, VectorSetFloat1(4.f));
+			const VectorRegister Lobe2Strength = VectorMultiply(Metallic, Metallic);
+			const VectorRegister Lobe2R = VectorMultiply(VectorMultiply(FalloffColorR, Lobe2Term), BaseR);
+			const VectorRegister Lobe2G = VectorMultiply(VectorMultiply(FalloffColorG, Lobe2Term), BaseG);
+			const VectorRegister Lobe2B = VectorMultiply(VectorMultiply(FalloffColorB, Lobe2Term), BaseB);
+			const VectorRegister Specular2R = VectorMultiply(VectorMultiply(Lobe2R, SqrtNonNegative(Lobe2R)), Lobe2Strength);
+			const VectorRegister Specular2G = VectorMultiply(VectorMultiply(Lobe2G, SqrtNonNegative(Lobe2G)), Lobe2Strength);
+			const VectorRegister Specular2B = VectorMultiply(VectorMultiply(Lobe2B, SqrtNonNegative(Lobe2B)), Lobe2Strength);
+
+			const VectorRegister KajiyaDiffuse = ToonStep(TerminatorRange, VectorSubtract(One, Saturate(VectorSubtract(NoL, Offset))));
+
+			// sqrt(BaseColor) * DiffuseScatter * BaseColor / Luma
+			const VectorRegister Luma = Dot3(BaseR, BaseG, BaseB, VectorSetFloat1(0.3f), VectorSetFloat1(0.59f), VectorSetFloat1(0.11f));
+			const VectorRegister DiffuseScatter = VectorDivide(VectorMultiply(VectorMultiply(KajiyaDiffuse, Scatter), VectorSetFloat1(1.f / PI)), Luma);
+			const VectorRegister ShadowTerm = VectorMultiply(VectorMultiply(Scatter, Half), VectorSubtract(One, KajiyaDiffuse));
+
+			const VectorRegister TransmissionScale = VectorMultiply(VectorMultiply(Scatter, Half), Falloff);
+			const VectorRegister DiffuseScale = VectorMultiply(VectorSubtract(One, VectorMultiply(Scatter, Half)), Falloff);
+
+			const VectorRegister HairR = VectorAdd(VectorAdd(Specular2R, VectorMultiply(VectorMultiply(SqrtNonNegative(BaseR), DiffuseScatter), BaseR)), VectorMultiply(ShadowTerm, VectorLoad(&Batch.DiffuseColorR[Index])));
+			const VectorRegister HairG = VectorAdd(VectorAdd(Specular2G, VectorMultiply(VectorMultiply(SqrtNonNegative(BaseG), DiffuseScatter), BaseG)), VectorMultiply(ShadowTerm, VectorLoad(&Batch.DiffuseColorG[Index])));
+			const VectorRegister HairB = VectorAdd(VectorAdd(Specular2B, VectorMultiply(VectorMultiply(SqrtNonNegative(BaseB), DiffuseScatter), BaseB)), VectorMultiply(ShadowTerm, VectorLoad(&Batch.DiffuseColorB[Index])));
+
+			VectorStore(VectorMultiply(HairR, TransmissionScale), &OutLighting.TransmissionR[Index]);
+			VectorStore(VectorMultiply(HairG, TransmissionScale), &OutLighting.TransmissionG[Index]);
+			VectorStore(VectorMultiply(HairB, TransmissionScale), &OutLighting.TransmissionB[Index]);
+			VectorStore(VectorMultiply(HairR, DiffuseScale), &OutLighting.DiffuseR[Index]);
+			VectorStore(VectorMultiply(HairG, DiffuseScale), &OutLighting.DiffuseG[Index]);
+			VectorStore(VectorMultiply(HairB, DiffuseScale), &OutLighting.DiffuseB[Index]);
+		}
+
+		// Remaining samples go through the scalar reference
+		for (int32 Index = NumVectorSamples; Index < NumSamples; ++Index)
+		{
+			FToonGBufferData GBuffer;
+			FVector N, V, L;
+			float Falloff;
+			Batch.GetSample(Index, GBuffer, N, V, L, Falloff);
+			OutLighting.SetSample(Index, ToonHairBxDF(GBuffer, N, V, L, Falloff, FalloffColor));
+		}
+	}
+}
@@ -0,0 +1,106 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+/*=============================================================================
+	ToonTileClassification.h: CPU emulation of the toon tile classification pass.
+
+	Mirrors ClassifyCS in /Engine/Private/ToonTileClassification.usf, so that tile counts and
+	coverage of the specialized light shaders can be measured from a dumped GBuffer without a GPU.
+=============================================================================*/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ToonShadingReference.h"
+
+namespace ToonShading
+{
+	/** Must match TOON_TILE_SIZE in ToonTileClassification.ush */
+	static const int32 ToonTileSize = 8;
+
+	/** Must match TOON_TILE_CLASS_* in ToonTileClassification.ush */
+	enum class EToonTileClass : uint8
+	{
+		Standard,
+		Toon,
+		ToonSkin,
+		ToonHair,
+		ToonAniso,
+		/** More than one of the above in the same tile. Drawn with the light shader that keeps every path. */
+		Mixed,
+		Num
+	};
+
+	ENGINE_API const TCHAR* GetToonTileClassName(EToonTileClass TileClass);
+
+	/** Port of GetToonTileClass. */
+	FORCEINLINE EToonTileClass GetToonTileClass(uint32 ShadingModelID)
+	{
+		switch (ShadingModelID)
+		{
+		case ShadingModelID_Toon:		return EToonTileClass::Toon;
+		case ShadingModelID_ToonSkin:	return EToonTileClass::ToonSkin;
+		case ShadingModelID_ToonHair:	return EToonTileClass::ToonHair;
+		case ShadingModelID_ToonAniso:	return EToonTileClass::ToonAniso;
+		default:						return EToonTileClass::Standard;
+		}
+	}
+
+	/** Output of ClassifyToonTiles. */
+	struct FToonTileClassification
+	{
+		int32 TileCountX = 0;
+		int32 TileCountY = 0;
+		/** Tiles without any lit pixel. They are not drawn at all. */
+		int32 NumEmptyTiles = 0;
+		/** Per EToonTileClass, packed TileX | (TileY << 16) in the same layout as RWToonTileList. */
+		TArray<uint32> TileLists[(int32)EToonTileClass::Num];
+		/** Per EToonTileClass, lit pixels inside the tiles of that class. */
+		int64 NumLitPixels[(int32)EToonTileClass::Num] = {};
+
+		int32 GetNumTiles() const { return TileCountX * TileCountY; }
+	};
+
+	/**
+	 * Classifies every TOON_TILE_SIZE^2 tile of a Width x Height view.
+	 * @param PackedGBufferB	GBufferB.a of the first pixel, 8 bit
+	 * @param PixelStride		Bytes between two horizontally adjacent pixels, e.g. 4 for BGRA8
+	 * @param RowStride			Bytes between two rows
+	 */
+	ENGINE_API void ClassifyToonTiles(const uint8* PackedGBufferB, int32 Width, int32 Height, int32 PixelStride, int32 RowStride, FToonTileClassification& OutClassification);
+
+	/** Output of SimulateWaveBxDFDispatch. */
+	struct FWaveBxDFDispatchStats
+	{
+		int32 WaveSize = 0;
+		/** Waves with at least one lit lane. The others do not run IntegrateBxDF at all. */
+		int64 NumWaves = 0;
+		/** Waves whose lit lanes all share one shading model. */
+		int64 NumUniformWaves = 0;
+		int64 NumLitLanes = 0;
+		/**
+		 * Sum over the waves of their distinct lit shading models. Both dispatches run one BxDF per distinct shading model,
+		 * and it is the iteration count of the TOON_SCALARIZE_BXDF_DISPATCH loop.
+		 */
+		int64 NumBxDFPasses = 0;
+		/**
+		 * Sum over the waves of the case tests the divergent switch evaluates per lane: the cases are tested in source order up to
+		 * the last one a lane of the wave takes, each being a vector compare and an exec mask update.
+		 */
+		int64 NumSwitchTests = 0;
+
+		/** Lit lanes over lanes issued by the BxDF passes. The same for both dispatches. */
+		double GetLaneUtilization() const { return NumBxDFPasses > 0 ? (double)NumLitLanes / ((double)NumBxDFPasses * WaveSize) : 0.0; }
+		/** Vector ops of the divergent switch itself, 2 per case test. */
+		int64 GetSwitchVectorOps() const { return NumSwitchTests * 2; }
+		/** Vector ops of the scalarized loop itself: a readfirstlane and a compare per iteration. Its switch is scalar. */
+		int64 GetScalarizedVectorOps() const { return NumBxDFPasses * 2; }
+	};
+
+	/**
+	 * Models the wave divergence of IntegrateBxDF over a GBufferB dump, for the plain switch and for TOON_SCALARIZE_BXDF_DISPATCH.
+	 * Pixel shader waves are assumed to cover 8 pixel wide blocks of whole 2x2 quads: 8x8 for 64 lanes, 8x4 for 32.
+	 * Same layout parameters as ClassifyToonTiles.
+	 * @param WaveSize	32 or 64
+	 */
+	ENGINE_API void SimulateWaveBxDFDispatch(const uint8* PackedGBufferB, int32 Width, int32 Height, int32 PixelStride, int32 RowStride, int32 WaveSize, FWaveBxDFDispatchStats& OutStats);
+}